@@ -15,6 +15,13 @@
 			[--assets <path-to-assets-folder>] \
 			[--loops <number-of-times-to-run-the-loop:[1, inf]>] \
 			[--rate <positive-rate:[0.0, 1.0]>] \
+			[--batch <number-of-images-per-batch:[1, inf]>] \
+			[--warmup <whether-to-warm-up-the-engine:true/false>] \
+			[--maxallocs <maximum-heap-allocations-per-call:[0, inf]>] \
+			[--stages <whether-to-print-the-timing-breakdown:true/false>] \
+			[--trace <path-to-trace-file>] \
+			[--cores <list-of-cores>] \
+			[--replay <whether-to-measure-capture-process-overlap:true/false>] \
 			[--tokenfile <path-to-license-token-file>] \
 			[--tokendata <base64-license-token-data>]
 
@@ -31,10 +38,17 @@
 
 #include <ultimateMRZ-SDK-API-PUBLIC.h>
 #include "../mrz_utils.h"
+#include "../mrz_result.h"
+#include "../mrz_trace.h"
+#include "../mrz_cpu.h"
+#include "../mrz_async.h"
 #include <chrono>
 #include <vector>
 #include <algorithm>
 #include <random>
+#include <cmath>
+#include <atomic>
+#include <new>
 #if defined(_WIN32)
 #include <algorithm> // std::replace
 #endif
@@ -66,6 +80,36 @@ static const char* __jsonConfig =
 "\"min_score\": 0.0"
 ;
 
+// Heap allocations counter. The global operator new is replaced to count the allocations done by this
+// application and by the SDK (when it uses the C++ allocator). On Windows, replacing the operator in the
+// executable doesn't affect the DLLs: only the allocations done by the application are counted.
+// Counting is only enabled with "--maxallocs": otherwise an allocation costs a relaxed load, not an atomic increment,
+// and the frame rates stay comparable with the previous versions.
+static std::atomic<bool> __allocCountEnabled(false);
+static std::atomic<size_t> __allocCount(0);
+void* operator new(size_t size)
+{
+	if (__allocCountEnabled.load(std::memory_order_relaxed)) {
+		__allocCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	void* ptr = malloc(size ? size : 1);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#	pragma GCC diagnostic push
+#	pragma GCC diagnostic ignored "-Wmismatched-new-delete" // false positive: GCC doesn't see that "operator new" above uses malloc
+#endif
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#	pragma GCC diagnostic pop
+#endif
+
 // Asset manager used on Android to files in "assets" folder
 #if ULTMRZ_SDK_OS_ANDROID 
 #	define ASSET_MGR_PARAM() __sdk_android_assetmgr, 
@@ -85,6 +129,13 @@ int main(int argc, char *argv[])
 	std::string assetsFolder, licenseTokenData, licenseTokenFile;
 	size_t loopCount = 100;
 	double percentPositives = .2; // 20%
+	size_t batchSize = 0; // zero means per-call loop only
+	bool warmUp = false;
+	int maxAllocs = -1; // negative means no check
+	bool stagesEnabled = false;
+	std::string pathFileTrace;
+	std::vector<int> cores; // empty means no pinning
+	bool replayEnabled = false;
 	std::string pathFilePositive;
 	std::string pathFileNegative;
 
@@ -120,6 +171,44 @@ int main(int argc, char *argv[])
 		}
 		loopCount = static_cast<size_t>(loops);
 	}
+	if (args.find("--batch") != args.end()) {
+		const int batch = std::atoi(args["--batch"].c_str());
+		if (batch < 1) {
+			printUsage("--batch must be within [1, inf]");
+			return -1;
+		}
+		batchSize = static_cast<size_t>(batch);
+	}
+	if (args.find("--warmup") != args.end()) {
+		warmUp = (args["--warmup"] == "true");
+	}
+	if (batchSize > 0 && !warmUp) {
+		ULTMRZ_SDK_PRINT_INFO("--batch enables --warmup: otherwise only the per-call loop would pay for the first (cold) call");
+		warmUp = true;
+	}
+	if (args.find("--stages") != args.end()) {
+		stagesEnabled = (args["--stages"] == "true");
+	}
+	if (args.find("--trace") != args.end()) {
+		pathFileTrace = args["--trace"];
+	}
+	if (args.find("--cores") != args.end()) {
+		if (!mrzCpuSetParse(args["--cores"], cores)) {
+			printUsage("--cores must be a list of cores, e.g. 0-3,6");
+			return -1;
+		}
+	}
+	if (args.find("--replay") != args.end()) {
+		replayEnabled = (args["--replay"] == "true");
+	}
+	if (args.find("--maxallocs") != args.end()) {
+		maxAllocs = std::atoi(args["--maxallocs"].c_str());
+		if (maxAllocs < 0) {
+			printUsage("--maxallocs must be within [0, inf]");
+			return -1;
+		}
+		__allocCountEnabled = true;
+	}
 
 	if (args.find("--assets") != args.end()) {
 		assetsFolder = args["--assets"];
@@ -149,6 +238,20 @@ int main(int argc, char *argv[])
 		jsonConfig += std::string(",\"license_token_data\": \"") + licenseTokenData + std::string("\"");
 	}
 	
+	// Pin the engine to a set of cores: the threads created by the engine inherit the affinity of the thread calling init/process
+	if (!cores.empty()) {
+		if (mrzCpuSetPinCurrentThread(cores)) {
+			mrzConfigSetNumThreads(jsonConfig, static_cast<int>(cores.size()));
+			ULTMRZ_SDK_PRINT_INFO("Pinned to %zu cores (%s), num_threads = %zu", cores.size(), args["--cores"].c_str(), cores.size());
+		}
+		else {
+			ULTMRZ_SDK_PRINT_WARN("Failed to pin to cores %s, CPU affinity not supported on this platform?", args["--cores"].c_str());
+		}
+	}
+	else {
+		mrzConfigAutoNumThreads(jsonConfig); // honor the container CPU quota and cpuset
+	}
+	
 	jsonConfig += "}"; // end-of-config
 
 	// Read files
@@ -173,26 +276,82 @@ int main(int argc, char *argv[])
 	}
 	std::shuffle(std::begin(indices), std::end(indices), std::default_random_engine{}); // make the indices random
 
+	// Trace
+	if (!pathFileTrace.empty()) {
+		mrzTracer().enable(std::max(loopCount * 4, static_cast<size_t>(4096)));
+	}
+
 	// Init
 	ULTMRZ_SDK_PRINT_INFO("Starting benchmark...");
-	ULTMRZ_SDK_ASSERT((result = UltMrzSdkEngine::init(
-		ASSET_MGR_PARAM()
-		jsonConfig.c_str()
-	)).isOK());
+	{
+		MrzTraceScope traceScope("init");
+		ULTMRZ_SDK_ASSERT((result = UltMrzSdkEngine::init(
+			ASSET_MGR_PARAM()
+			jsonConfig.c_str()
+		)).isOK());
+	}
+
+	// Warm-up: load and initialize the models before the loop
+	if (warmUp) {
+		MrzTraceScope traceScope("warm-up");
+		const std::chrono::high_resolution_clock::time_point timeStartWarmUp = std::chrono::high_resolution_clock::now();
+		// Using the decoded images: a blank frame has no MRZ and wouldn't warm up the recognizer
+		const MrzImage samples[2] = { mrzFileToImage(fileNegative), mrzFileToImage(filePositive) };
+		ULTMRZ_SDK_ASSERT(mrzWarmUp(samples, 2));
+		ULTMRZ_SDK_PRINT_INFO("Warm-up time = %lf millis", std::chrono::duration_cast<std::chrono::duration<double >>(std::chrono::high_resolution_clock::now() - timeStartWarmUp).count() * 1000.0);
+	}
 
 	// Recognize/Process
 	const std::chrono::high_resolution_clock::time_point timeStart = std::chrono::high_resolution_clock::now();
 	const MrzFile* files[2] = { &fileNegative, &filePositive };
 	UltMrzSdkResult resultPositive(0, "OK", "{}");
+	double elapsedTimeInMillisPerType[2] = { 0.0, 0.0 }; // negatives, positives
+	size_t countPerType[2] = { 0, 0 };
+	double firstCallTimeInMillis = -1.0;
+	size_t firstCallAllocs = 0, steadyStateAllocs = 0, steadyStateMaxAllocs = 0;
+	MrzResult mrzResult;
+	double engineDuration = 0.0, decodeTimeInMillis = 0.0;
+	size_t numZones = 0, numLines = 0;
+	std::vector<double> frameTimesInMillis;
+	frameTimesInMillis.reserve(indices.size()); // no allocation inside the loop
 	for (const auto& indice : indices) {
 		const MrzFile* file = files[indice];
 		UltMrzSdkResult* result_ = indice ? &resultPositive : &result;
-		ULTMRZ_SDK_ASSERT((*result_ = UltMrzSdkEngine::process(
-			file->type,
-			file->uncompressedData,
-			file->width,
-			file->height
-		)).isOK());
+		const size_t allocCountStart = __allocCount.load();
+		const std::chrono::high_resolution_clock::time_point timeStartFrame = std::chrono::high_resolution_clock::now();
+		{
+			MrzTraceScope traceScope(indice ? "process (positive)" : "process (negative)");
+			MRZ_PROBE3(process__entry, file->width, file->height, static_cast<int>(file->type));
+			ULTMRZ_SDK_ASSERT((*result_ = UltMrzSdkEngine::process(
+				file->type,
+				file->uncompressedData,
+				file->width,
+				file->height
+			)).isOK());
+			MRZ_PROBE2(process__return, result_->code(), result_->numZones());
+		}
+		const double frameTimeInMillis = std::chrono::duration_cast<std::chrono::duration<double >>(std::chrono::high_resolution_clock::now() - timeStartFrame).count() * 1000.0;
+		const size_t frameAllocs = __allocCount.load() - allocCountStart;
+		if (firstCallTimeInMillis < 0.0) {
+			firstCallTimeInMillis = frameTimeInMillis;
+			firstCallAllocs = frameAllocs;
+		}
+		else {
+			steadyStateAllocs += frameAllocs;
+			steadyStateMaxAllocs = std::max(steadyStateMaxAllocs, frameAllocs);
+		}
+		elapsedTimeInMillisPerType[indice] += frameTimeInMillis;
+		frameTimesInMillis.push_back(frameTimeInMillis);
+		++countPerType[indice];
+		if (stagesEnabled) {
+			MrzTraceScope traceScope("decode");
+			const std::chrono::high_resolution_clock::time_point timeStartDecode = std::chrono::high_resolution_clock::now();
+			ULTMRZ_SDK_ASSERT(mrzResultDecode(*result_, mrzResult));
+			decodeTimeInMillis += std::chrono::duration_cast<std::chrono::duration<double >>(std::chrono::high_resolution_clock::now() - timeStartDecode).count() * 1000.0;
+			engineDuration += mrzResult.duration;
+			numZones += mrzResult.zones.size();
+			numLines += mrzResult.lines.size();
+		}
 	}
 	const std::chrono::high_resolution_clock::time_point timeEnd = std::chrono::high_resolution_clock::now();
 	const double elapsedTimeInMillis = std::chrono::duration_cast<std::chrono::duration<double >>(timeEnd - timeStart).count() * 1000.0;
@@ -208,6 +367,128 @@ int main(int argc, char *argv[])
 	const double estimatedFps = 1000.f / (elapsedTimeInMillis / (double)loopCount);
 	ULTMRZ_SDK_PRINT_INFO("*** elapsedTimeInMillis: %lf, estimatedFps: %lf ***", elapsedTimeInMillis, estimatedFps);
 
+	// Print first-call and steady-state latencies
+	if (loopCount > 1) {
+		ULTMRZ_SDK_PRINT_INFO("*** first call: %lf millis, steady-state: %lf millis ***", 
+			firstCallTimeInMillis, (elapsedTimeInMillisPerType[0] + elapsedTimeInMillisPerType[1] - firstCallTimeInMillis) / (double)(loopCount - 1));
+	}
+
+	// Print latency percentiles (nearest rank)
+	std::sort(frameTimesInMillis.begin(), frameTimesInMillis.end());
+	auto percentile = [&frameTimesInMillis](const double p) {
+		return frameTimesInMillis[std::min(frameTimesInMillis.size() - 1, static_cast<size_t>(std::ceil((p / 100.0) * frameTimesInMillis.size())) - 1)];
+	};
+	ULTMRZ_SDK_PRINT_INFO("*** latency: p50: %lf millis, p95: %lf millis, p99: %lf millis, max: %lf millis ***",
+		percentile(50.0), percentile(95.0), percentile(99.0), frameTimesInMillis.back());
+
+	// Print heap allocations per call
+	if (maxAllocs >= 0 && loopCount > 1) {
+		ULTMRZ_SDK_PRINT_INFO("*** heap allocations per call: first call: %zu, steady-state: %lf (max %zu) ***",
+			firstCallAllocs, (double)steadyStateAllocs / (double)(loopCount - 1), steadyStateMaxAllocs);
+		ULTMRZ_SDK_ASSERT(steadyStateMaxAllocs <= static_cast<size_t>(maxAllocs));
+	}
+
+	// Print timing breakdown
+	if (stagesEnabled) {
+		const double processTimeInMillis = elapsedTimeInMillisPerType[0] + elapsedTimeInMillisPerType[1];
+		ULTMRZ_SDK_PRINT_INFO("*** stages (mean per frame): process() call: %lf millis, engine \"duration\": %lf millis, JSON decoding: %lf millis, zones: %lf, lines: %lf ***",
+			processTimeInMillis / (double)loopCount, engineDuration / (double)loopCount, decodeTimeInMillis / (double)loopCount,
+			(double)numZones / (double)loopCount, (double)numLines / (double)loopCount);
+	}
+
+	// Print memory usage
+	size_t memoryCurrent, memoryPeak;
+	if (mrzMemoryUsage(memoryCurrent, memoryPeak)) {
+		ULTMRZ_SDK_PRINT_INFO("*** memory: current: %zu KB, peak: %zu KB ***", memoryCurrent >> 10, memoryPeak >> 10);
+	}
+
+	// Print negative-only and positive-only frame rates
+	static const char* kTypeNames[2] = { "negatives", "positives" };
+	for (size_t i = 0; i < 2; ++i) {
+		if (countPerType[i]) {
+			ULTMRZ_SDK_PRINT_INFO("*** %s: count: %zu, elapsedTimeInMillis: %lf, estimatedFps: %lf ***", 
+				kTypeNames[i], countPerType[i], elapsedTimeInMillisPerType[i], 1000.0 / (elapsedTimeInMillisPerType[i] / (double)countPerType[i]));
+		}
+	}
+
+	// Batch pass: consistency check of mrzProcessBatch. The engine has no batch entry point, the helper loops over
+	// process() which means no throughput gain is expected: the zones found must be the same as in the per-call loop.
+	if (batchSize > 0) {
+		std::vector<MrzImage> images(indices.size());
+		for (size_t i = 0; i < indices.size(); ++i) {
+			images[i] = mrzFileToImage(*files[indices[i]]);
+		}
+		std::vector<UltMrzSdkResult> results;
+		size_t mismatches = 0;
+		const std::chrono::high_resolution_clock::time_point timeStartBatch = std::chrono::high_resolution_clock::now();
+		for (size_t start = 0; start < images.size(); start += batchSize) {
+			const size_t count = std::min(batchSize, images.size() - start);
+			MrzTraceScope traceScope("batch");
+			ULTMRZ_SDK_ASSERT(mrzProcessBatch(&images[start], count, results));
+			for (size_t i = 0; i < count; ++i) {
+				mismatches += (results[i].numZones() != (indices[start + i] ? resultPositive : result).numZones());
+			}
+		}
+		const std::chrono::high_resolution_clock::time_point timeEndBatch = std::chrono::high_resolution_clock::now();
+		const double elapsedTimeInMillisBatch = std::chrono::duration_cast<std::chrono::duration<double >>(timeEndBatch - timeStartBatch).count() * 1000.0;
+		ULTMRZ_SDK_PRINT_INFO("*** batch pass (consistency check, loop over process()): batchSize: %zu, elapsedTimeInMillis: %lf, imagesPerSec: %lf, zones mismatches: %zu ***", 
+			batchSize, elapsedTimeInMillisBatch, 1000.0 / (elapsedTimeInMillisBatch / (double)loopCount), mismatches);
+	}
+
+	// Video replay: every frame is first copied into a capture buffer (like a camera or video decoder would do) then processed.
+	// Serial: copy and process one after the other. Overlapped: a single worker calls process() while the main thread copies
+	// the next frame. Only the capture overlaps the processing: process() is never called concurrently and the engine's own
+	// stages (detection, recognition) are not pipelined.
+	if (replayEnabled) {
+		const size_t maxInFlight = 2; // the frame being processed and the next one
+		auto frameSize = [](const MrzFile& file) {
+			return file.width * file.height * (file.type == ULTMRZ_SDK_IMAGE_TYPE_RGB24 ? 3 : (file.type == ULTMRZ_SDK_IMAGE_TYPE_Y ? 1 : 4));
+		};
+		std::vector<std::vector<uint8_t> > captureBuffers(maxInFlight + 1, std::vector<uint8_t>(std::max(frameSize(fileNegative), frameSize(filePositive))));
+		auto capture = [&](const size_t index, const size_t frame) {
+			const MrzFile* file = files[indices[frame]];
+			std::vector<uint8_t>& buffer = captureBuffers[index];
+			memcpy(buffer.data(), file->uncompressedData, frameSize(*file));
+			MrzImage image = mrzFileToImage(*file);
+			image.data = buffer.data();
+			return image;
+		};
+
+		const std::chrono::high_resolution_clock::time_point timeStartSerial = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < indices.size(); ++i) {
+			ULTMRZ_SDK_ASSERT(mrzProcessImage(capture(0, i)).isOK());
+		}
+		const double elapsedTimeInMillisSerial = std::chrono::duration_cast<std::chrono::duration<double >>(std::chrono::high_resolution_clock::now() - timeStartSerial).count() * 1000.0;
+
+		// A capture buffer is reused only once its frame is delivered: at most "maxInFlight" frames are pending
+		size_t nextSequence = 0;
+		bool inOrder = true;
+		const std::chrono::high_resolution_clock::time_point timeStartOverlapped = std::chrono::high_resolution_clock::now();
+		{
+			MrzAsyncProcessor processor(maxInFlight, 1);
+			processor.setOrdered(true);
+			for (size_t i = 0; i < indices.size(); ++i) {
+				processor.submit(capture(i % captureBuffers.size(), i), [&nextSequence, &inOrder](const MrzAsyncResult& asyncResult) {
+					ULTMRZ_SDK_ASSERT(asyncResult.result.isOK());
+					inOrder &= (asyncResult.sequence == nextSequence++);
+				});
+			}
+			processor.flush();
+		}
+		const double elapsedTimeInMillisOverlapped = std::chrono::duration_cast<std::chrono::duration<double >>(std::chrono::high_resolution_clock::now() - timeStartOverlapped).count() * 1000.0;
+		ULTMRZ_SDK_ASSERT(inOrder);
+		ULTMRZ_SDK_PRINT_INFO("*** video replay: serial (copy then process): %lf fps, copy overlapped with process: %lf fps ***",
+			1000.0 / (elapsedTimeInMillisSerial / (double)indices.size()), 1000.0 / (elapsedTimeInMillisOverlapped / (double)indices.size()));
+	}
+
+	// Write the trace
+	if (!pathFileTrace.empty()) {
+		mrzTracer().disable();
+		if (mrzTracer().dump(pathFileTrace)) {
+			ULTMRZ_SDK_PRINT_INFO("Trace written to %s (open with chrome://tracing or https://ui.perfetto.dev)", pathFileTrace.c_str());
+		}
+	}
+
 	ULTMRZ_SDK_PRINT_INFO("Press any key to terminate !!");
 	getchar();
 
@@ -235,6 +516,13 @@ static void printUsage(const std::string& message /*= ""*/)
 		"\t[--assets <path-to-assets-folder>] \n"
 		"\t[--loops <number-of-times-to-run-the-loop:[1, inf]>] \n"
 		"\t[--rate <positive-rate:[0.0, 1.0]>] \n"
+		"\t[--batch <number-of-images-per-batch:[1, inf]>] \n"
+		"\t[--warmup <whether-to-warm-up-the-engine:true/false>] \n"
+		"\t[--maxallocs <maximum-heap-allocations-per-call:[0, inf]>] \n"
+		"\t[--stages <whether-to-print-the-timing-breakdown:true/false>] \n"
+		"\t[--trace <path-to-trace-file>] \n"
+		"\t[--cores <list-of-cores>] \n"
+		"\t[--replay <whether-to-measure-capture-process-overlap:true/false>] \n"
 		"\t[--tokenfile <path-to-license-token-file>] \n"
 		"\t[--tokendata <base64-license-token-data>] \n"
 		"\n"
@@ -245,6 +533,13 @@ static void printUsage(const std::string& message /*= ""*/)
 		"--assets: Path to the assets folder containing the configuration files and models. Default value is the current folder.\n"
 		"--loops: Number of times to run the processing pipeline.\n"
 		"--rate: Percentage value within[0.0, 1.0] defining the positive rate. The positive rate defines the percentage of images with MRZ lines.\n"
+		"--batch: Number of images per batch. If defined then, the images are processed again using mrzProcessBatch as a consistency check (same zones as the per-call loop). The helper loops over process(): no throughput gain is expected. Enables --warmup. Default: not defined.\n"
+		"--warmup: Whether to warm up the engine (models loading and initialization) before the loop. Default: false.\n"
+		"--maxallocs: Maximum number of heap allocations per call after the first one. The allocations are only counted (and printed) when defined. The application asserts if this number is exceeded. Default: not defined.\n"
+		"--stages: Whether to decode every result and print the timing breakdown (process() call, engine duration, JSON decoding) and the mean number of zones and lines. Default: false.\n"
+		"--trace: Path to the Chrome trace JSON file to write with the init, warm-up, process() and decoding events. Could be opened with chrome://tracing or https://ui.perfetto.dev. Default: not defined.\n"
+		"--cores: List of cores to run the engine on, e.g. 0-3,6 (same format as taskset -c). The engine threads are pinned to these cores and num_threads is set to their number. Linux and Android only. Default: not defined.\n"
+		"--replay: Whether to measure the capture/process overlap. If true then, the frames are copied into capture buffers and processed again: serially then by a single worker thread while the next frame is copied. Both frame rates are printed. Default: false.\n"
 		"--tokenfile: Path to the file containing the base64 license token if you have one. If not provided then, the application will act like a trial version. Default: null.\n"
 		"--tokendata: Base64 license token if you have one. If not provided then, the application will act like a trial version. Default: null.\n"
 		"********************************************************************************\n"
@@ -0,0 +1,301 @@
+/* Copyright (C) 2016-2019 Doubango Telecom <https://www.doubango.org>
+* File author: Mamadou DIOP (Doubango Telecom, France).
+* License: For non commercial use only.
+* Source code: https://github.com/DoubangoTelecom/ultimateMRZ-SDK
+* WebSite: https://www.doubango.org/webapps/mrz/
+*/
+
+#if !defined(_ULTIMATE_MRZ_SDK_SAMPLES_ASYNC_H_)
+#define _ULTIMATE_MRZ_SDK_SAMPLES_ASYNC_H_
+
+#include "mrz_utils.h"
+#include "mrz_stats.h"
+#include "mrz_trace.h"
+#include "mrz_cpu.h"
+#include <stdint.h>
+#include <string.h>
+#include <deque>
+#include <map>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+/*
+* Result delivered by the asynchronous processor
+*/
+struct MrzAsyncResult {
+	int64_t frameId = -1; // "frame_id" from the JSON result, -1 if not available
+	uint64_t sequence = 0; // submission index, starts at zero
+	UltMrzSdkResult result;
+};
+
+typedef std::function<void(const MrzAsyncResult& asyncResult)> MrzAsyncCallback;
+typedef std::function<void(std::function<void()> job)> MrzExecutor; // runs "job" on one of your threads
+
+/*
+* Extracts the "frame_id" value from a JSON result
+* @param json
+* @returns the frame id or -1 if not found
+*/
+static inline int64_t mrzJsonFrameId(const char* json)
+{
+	static const char kKey[] = "\"frame_id\":";
+	const char* pos = json ? strstr(json, kKey) : nullptr;
+	return pos ? static_cast<int64_t>(strtoll(pos + sizeof(kKey) - 1, nullptr, 10)) : -1;
+}
+
+/*
+* Runs UltMrzSdkEngine::process() on background threads so that the caller could decode
+* the next frame (or do network I/O) while the current one is being recognized.
+* At most "maxInFlight" frames are queued or being processed at any time: submitting a
+* new frame blocks until a slot is available.
+* The image data is not copied: the memory must remain valid until the completion
+* callback is called (or the future is ready).
+* The engine has its own internal threads ("num_threads" config entry) which means a single
+* worker (the default) is enough in most cases: the calls to UltMrzSdkEngine::process() are then serialized
+* and only the caller's work overlaps the processing.
+* With several workers (or an executor running jobs in parallel) UltMrzSdkEngine::process() is called
+* concurrently from different threads: the public API doesn't document whether this is safe, don't rely on it
+* in production.
+* When "stats" is defined, the processing latency and the time spent in the queue waiting for a worker
+* are recorded for each frame.
+* When the tracer is enabled (mrzTracer()), "queue" and "process" events are recorded for each frame.
+* The workers could be pinned to a set of cores (see "pinWorkers") or replaced by your own executor
+* (thread pool, event loop...) using the second constructor.
+* With several workers the frames are processed concurrently and could complete out of order: enable
+* "setOrdered" to get the callbacks in submission order (video streams).
+*/
+class MrzAsyncProcessor {
+public:
+	MrzAsyncProcessor(const size_t maxInFlight = 4, const size_t numWorkers = 1, MrzStats* stats = nullptr)
+		: maxInFlight_(maxInFlight ? maxInFlight : 1), stats_(stats)
+	{
+		const size_t count = numWorkers ? numWorkers : 1;
+		for (size_t i = 0; i < count; ++i) {
+			workers_.push_back(std::thread(&MrzAsyncProcessor::run, this));
+		}
+	}
+	/*
+	* Runs the frames on an external executor instead of private threads. One job is posted per submitted
+	* frame. The executor must run all the jobs posted before "stop" (or the destructor) returns.
+	*/
+	MrzAsyncProcessor(MrzExecutor executor, const size_t maxInFlight = 4, MrzStats* stats = nullptr)
+		: maxInFlight_(maxInFlight ? maxInFlight : 1), stats_(stats), executor_(std::move(executor))
+	{
+		ULTMRZ_SDK_ASSERT(executor_ != nullptr);
+	}
+	virtual ~MrzAsyncProcessor() {
+		stop();
+	}
+
+	/*
+	* Queues a frame for processing. Blocks while "maxInFlight" frames are pending.
+	* @param image
+	* @param callback Function called on the worker thread when the frame is processed.
+	* @returns false if the processor is stopped, true otherwise
+	*/
+	bool submit(const MrzImage& image, MrzAsyncCallback callback) {
+		ULTMRZ_SDK_ASSERT(image.isValid() && callback);
+		std::unique_lock<std::mutex> lock(mutex_);
+		condSlot_.wait(lock, [this] { return stopped_ || inFlight_ < maxInFlight_; });
+		if (stopped_) {
+			return false;
+		}
+		++inFlight_;
+		tasks_.push_back(Task{ image, std::move(callback), (stats_ || mrzTracer().isEnabled()) ? MrzStats::nowInMicros() : 0, nextSequence_++, ordered_ });
+		if (executor_) {
+			lock.unlock();
+			executor_([this] { runOnce(); });
+		}
+		else {
+			condTask_.notify_one();
+		}
+		return true;
+	}
+
+	/*
+	* Same as above but returns a future instead of calling a function.
+	* The future is invalid if the processor is stopped.
+	*/
+	std::future<MrzAsyncResult> submit(const MrzImage& image) {
+		std::shared_ptr<std::promise<MrzAsyncResult> > promise = std::make_shared<std::promise<MrzAsyncResult> >();
+		std::future<MrzAsyncResult> future = promise->get_future();
+		if (!submit(image, [promise](const MrzAsyncResult& asyncResult) { promise->set_value(asyncResult); })) {
+			return std::future<MrzAsyncResult>();
+		}
+		return future;
+	}
+
+	/*
+	* Waits until all submitted frames are processed.
+	*/
+	void flush() {
+		std::unique_lock<std::mutex> lock(mutex_);
+		condSlot_.wait(lock, [this] { return inFlight_ == 0; });
+	}
+
+	/*
+	* Delivers the results in submission order: a frame completed before the previous ones is held until they
+	* complete. Its slot is released only when its callback returns. Could only be changed when no frame is in flight.
+	* @returns false if frames are in flight, true otherwise
+	*/
+	bool setOrdered(const bool ordered) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (inFlight_) {
+			return false;
+		}
+		ordered_ = ordered;
+		nextDelivery_ = nextSequence_;
+		return true;
+	}
+
+	/*
+	* Restricts the private workers to a set of cores (e.g. from mrzCpuSetParse).
+	* @returns false if not supported on this platform, true otherwise
+	*/
+	bool pinWorkers(const std::vector<int>& cores) {
+		bool allOK = !workers_.empty();
+		for (std::thread& worker : workers_) {
+			allOK &= mrzCpuSetPinThread(worker, cores);
+		}
+		return allOK;
+	}
+
+	/*
+	* Processes the pending frames then stops the workers.
+	*/
+	void stop() {
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			if (stopped_) {
+				return;
+			}
+			stopped_ = true;
+			if (executor_) {
+				condSlot_.wait(lock, [this] { return inFlight_ == 0; });
+			}
+		}
+		condTask_.notify_all();
+		condSlot_.notify_all();
+		for (std::thread& worker : workers_) {
+			worker.join();
+		}
+		workers_.clear();
+	}
+
+	inline size_t maxInFlight() const {
+		return maxInFlight_;
+	}
+
+private:
+	struct Task {
+		MrzImage image;
+		MrzAsyncCallback callback;
+		int64_t submitTime; // microseconds, only when "stats_" is defined or the tracer enabled
+		uint64_t sequence;
+		bool ordered;
+	};
+	struct Pending {
+		MrzAsyncCallback callback;
+		MrzAsyncResult asyncResult;
+	};
+
+	void run() {
+		MrzAsyncResult asyncResult;
+		for (;;) {
+			Task task;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				condTask_.wait(lock, [this] { return stopped_ || !tasks_.empty(); });
+				if (tasks_.empty()) {
+					return; // stopped and nothing left to process
+				}
+				task = std::move(tasks_.front());
+				tasks_.pop_front();
+			}
+			execute(task, asyncResult);
+		}
+	}
+
+	// Job posted to the external executor: processes the oldest pending frame
+	void runOnce() {
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			if (tasks_.empty()) {
+				return;
+			}
+			task = std::move(tasks_.front());
+			tasks_.pop_front();
+		}
+		MrzAsyncResult asyncResult;
+		execute(task, asyncResult);
+	}
+
+	void execute(Task& task, MrzAsyncResult& asyncResult) {
+		const int64_t dequeueTime = task.submitTime ? MrzStats::nowInMicros() : 0;
+		if (stats_) {
+			stats_->recordWait(static_cast<uint64_t>(dequeueTime - task.submitTime));
+		}
+		{
+			MrzTraceScope traceScope("process");
+			asyncResult.result = stats_ ? mrzProcessImageWithStats(task.image, *stats_) : mrzProcessImage(task.image);
+			asyncResult.frameId = mrzJsonFrameId(asyncResult.result.json());
+			asyncResult.sequence = task.sequence;
+			traceScope.setFrameId(asyncResult.frameId);
+		}
+		if (task.submitTime && mrzTracer().isEnabled()) {
+			mrzTracer().record("queue", task.submitTime, dequeueTime, asyncResult.frameId);
+		}
+		if (!task.ordered) {
+			task.callback(asyncResult);
+			std::unique_lock<std::mutex> lock(mutex_);
+			--inFlight_;
+			condSlot_.notify_all(); // under the lock: "stop" could destroy the object as soon as it's released (executor mode)
+			return;
+		}
+
+		// In order delivery: the result is held in the reorder buffer. The first worker finding the next expected
+		// result delivers all consecutive ones, the others return immediately.
+		std::unique_lock<std::mutex> lock(mutex_);
+		pending_[task.sequence] = Pending{ std::move(task.callback), asyncResult };
+		if (delivering_) {
+			return;
+		}
+		delivering_ = true;
+		while (!pending_.empty() && pending_.begin()->first == nextDelivery_) {
+			Pending pending = std::move(pending_.begin()->second);
+			pending_.erase(pending_.begin());
+			++nextDelivery_;
+			lock.unlock();
+			pending.callback(pending.asyncResult);
+			lock.lock();
+			--inFlight_;
+			condSlot_.notify_all();
+		}
+		delivering_ = false;
+	}
+
+private:
+	const size_t maxInFlight_;
+	MrzStats* stats_;
+	MrzExecutor executor_;
+	size_t inFlight_ = 0;
+	bool stopped_ = false;
+	bool ordered_ = false;
+	bool delivering_ = false;
+	uint64_t nextSequence_ = 0;
+	uint64_t nextDelivery_ = 0;
+	std::map<uint64_t, Pending> pending_; // reorder buffer, in order delivery only
+	std::deque<Task> tasks_;
+	std::vector<std::thread> workers_;
+	std::mutex mutex_;
+	std::condition_variable condTask_;
+	std::condition_variable condSlot_;
+};
+
+#endif /* _ULTIMATE_MRZ_SDK_SAMPLES_ASYNC_H_ */
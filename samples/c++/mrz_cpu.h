@@ -0,0 +1,366 @@
+/* Copyright (C) 2016-2019 Doubango Telecom <https://www.doubango.org>
+* File author: Mamadou DIOP (Doubango Telecom, France).
+* License: For non commercial use only.
+* Source code: https://github.com/DoubangoTelecom/ultimateMRZ-SDK
+* WebSite: https://www.doubango.org/webapps/mrz/
+*/
+
+#if !defined(_ULTIMATE_MRZ_SDK_SAMPLES_CPU_H_)
+#define _ULTIMATE_MRZ_SDK_SAMPLES_CPU_H_
+
+#include <ultimateMRZ-SDK-API-PUBLIC.h> // no dependency on mrz_utils.h, could be used by all samples
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+#if defined(__linux__) || ULTMRZ_SDK_OS_ANDROID
+#	include <sched.h>
+#	include <pthread.h>
+#	define MRZ_CPU_AFFINITY_SUPPORTED	1
+#	define MRZ_CPU_MAX_CORES			CPU_SETSIZE
+#else
+#	define MRZ_CPU_MAX_CORES			1024
+#endif
+
+/*
+* Parses a list of cores, same format as "taskset -c" and the cgroup "cpuset.cpus" files, e.g. "0-3,8,10-11".
+* @param list
+* @param cores The core indices, in increasing order as listed.
+* @returns false if the list is malformed, empty or has a core index >= MRZ_CPU_MAX_CORES, true otherwise
+*/
+static inline bool mrzCpuSetParse(const std::string& list, std::vector<int>& cores)
+{
+	cores.clear();
+	const char* ptr = list.c_str();
+	while (*ptr) {
+		char* end;
+		const long first = strtol(ptr, &end, 10);
+		if (end == ptr || first < 0 || first >= MRZ_CPU_MAX_CORES) {
+			return false;
+		}
+		long last = first;
+		ptr = end;
+		if (*ptr == '-') {
+			last = strtol(++ptr, &end, 10);
+			if (end == ptr || last < first || last >= MRZ_CPU_MAX_CORES) {
+				return false;
+			}
+			ptr = end;
+		}
+		for (long core = first; core <= last; ++core) {
+			cores.push_back(static_cast<int>(core));
+		}
+		while (*ptr == ',' || *ptr == ' ' || *ptr == '\n') {
+			++ptr;
+		}
+	}
+	return !cores.empty();
+}
+
+/*
+* Gets the cores the calling thread is allowed to run on (e.g. restricted using "taskset" or "docker --cpuset-cpus").
+* @param cores
+* @returns the number of cores, std::thread::hardware_concurrency() if the affinity is not supported on this platform
+*/
+static inline size_t mrzCpuSetCurrent(std::vector<int>& cores)
+{
+	cores.clear();
+#if MRZ_CPU_AFFINITY_SUPPORTED
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+		for (int core = 0; core < CPU_SETSIZE; ++core) {
+			if (CPU_ISSET(core, &set)) {
+				cores.push_back(core);
+			}
+		}
+		return cores.size();
+	}
+#endif /* MRZ_CPU_AFFINITY_SUPPORTED */
+	return static_cast<size_t>(std::thread::hardware_concurrency());
+}
+
+/*
+* Restricts the calling thread to a set of cores.
+* The threads created after this call by the calling thread inherit the affinity: call it before UltMrzSdkEngine::init
+* (and from the thread calling UltMrzSdkEngine::process) to keep the engine's internal threads away from the cores
+* used by the other hot services (video decoder, network...). Set "num_threads" to the number of cores.
+* @param cores
+* @returns false if the affinity is not supported on this platform or the cores are invalid, true otherwise
+*/
+static inline bool mrzCpuSetPinCurrentThread(const std::vector<int>& cores)
+{
+#if MRZ_CPU_AFFINITY_SUPPORTED
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int core : cores) {
+		if (core < 0 || core >= CPU_SETSIZE) {
+			return false;
+		}
+		CPU_SET(core, &set);
+	}
+	if (!cores.empty() && sched_setaffinity(0, sizeof(set), &set) == 0) {
+		return true;
+	}
+	ULTMRZ_SDK_PRINT_ERROR("sched_setaffinity failed");
+#else
+	(void)cores;
+#endif /* MRZ_CPU_AFFINITY_SUPPORTED */
+	return false;
+}
+
+/*
+* Same as above for a thread other than the calling one. Not available on Android (use mrzCpuSetPinCurrentThread
+* from the thread itself).
+*/
+static inline bool mrzCpuSetPinThread(std::thread& thread, const std::vector<int>& cores)
+{
+#if MRZ_CPU_AFFINITY_SUPPORTED && !ULTMRZ_SDK_OS_ANDROID
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int core : cores) {
+		if (core < 0 || core >= CPU_SETSIZE) {
+			return false;
+		}
+		CPU_SET(core, &set);
+	}
+	return !cores.empty() && pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+	(void)thread, (void)cores;
+	return false;
+#endif
+}
+
+/*
+* Path of the cgroup the process belongs to, relative to the controller's mount point, from "/proc/self/cgroup":
+* "0::/path" (v2) or "<id>:<controllers>:/path" (v1, e.g. "4:cpu,cpuacct:/docker/<id>").
+* @param controller The v1 controller (e.g. "cpu", "memory"), nullptr for v2.
+* @returns the path (e.g. "/docker/<id>", "/" with a cgroup namespace), empty if not found
+*/
+static inline std::string mrzCgroupPath(const char* controller)
+{
+	std::string path;
+#if defined(__linux__) || ULTMRZ_SDK_OS_ANDROID
+	FILE* file = fopen("/proc/self/cgroup", "r");
+	if (!file) {
+		return path;
+	}
+	char line[512];
+	while (path.empty() && fgets(line, sizeof(line), file)) {
+		char* controllers = strchr(line, ':');
+		char* relative = controllers ? strchr(controllers + 1, ':') : nullptr;
+		if (!relative) {
+			continue;
+		}
+		*relative++ = '\0', ++controllers;
+		relative[strcspn(relative, "\n")] = '\0';
+		if (!controller) {
+			if (!*controllers) {
+				path = relative;
+			}
+			continue;
+		}
+		if ((std::string(",") + controllers + ",").find(std::string(",") + controller + ",") != std::string::npos) {
+			path = relative;
+		}
+	}
+	fclose(file);
+#else
+	(void)controller;
+#endif /* __linux__ */
+	return path;
+}
+
+/*
+* Directories to search for the cgroup files of a controller: the process' own cgroup (see mrzCgroupPath)
+* under each mount point, then the mount points themselves. The root is what a container sees with a cgroup
+* namespace (the default with v2), the process' cgroup is needed without a namespace or outside a container.
+* @param mountPoints
+* @param numMountPoints
+* @param controller The v1 controller, nullptr for v2.
+*/
+static inline std::vector<std::string> mrzCgroupDirs(const char** mountPoints, const size_t numMountPoints, const char* controller)
+{
+	std::vector<std::string> dirs;
+	const std::string path = mrzCgroupPath(controller);
+	for (size_t i = 0; i < numMountPoints; ++i) {
+		if (!path.empty() && path != "/") {
+			dirs.push_back(std::string(mountPoints[i]) + path);
+		}
+	}
+	dirs.insert(dirs.end(), mountPoints, mountPoints + numMountPoints);
+	return dirs;
+}
+
+/*
+* CPU quota of the container (Docker "--cpus", Kubernetes "limits.cpu"...) from the cgroup files of the process:
+* "cpu.max" (v2) or "cpu.cfs_quota_us" and "cpu.cfs_period_us" (v1).
+* A quota set on an intermediate parent cgroup (neither the process' cgroup nor the root) isn't seen.
+* @param cpus The quota in number of CPUs (e.g. 2.5), zero if there is no quota.
+* @returns false if no cgroup file could be read (not Linux, not a container...), true otherwise
+*/
+static inline bool mrzCgroupCpuQuota(double& cpus)
+{
+	cpus = 0.0;
+#if defined(__linux__) || ULTMRZ_SDK_OS_ANDROID
+	char quota[32] = { 0 };
+	long long quotaInMicros = 0, periodInMicros = 0;
+	static const char* kMountPointsV2[] = { "/sys/fs/cgroup" };
+	for (const std::string& dir : mrzCgroupDirs(kMountPointsV2, 1, nullptr)) {
+		FILE* file = fopen((dir + "/cpu.max").c_str(), "r"); // v2, "max 100000" or "400000 100000"
+		if (!file) {
+			continue;
+		}
+		const int count = fscanf(file, "%31s %lld", quota, &periodInMicros);
+		fclose(file);
+		if (count == 2 && strcmp(quota, "max") && periodInMicros > 0 && (quotaInMicros = atoll(quota)) > 0) {
+			cpus = static_cast<double>(quotaInMicros) / static_cast<double>(periodInMicros);
+		}
+		return (count == 2);
+	}
+	static const char* kMountPointsV1[] = { "/sys/fs/cgroup/cpu,cpuacct", "/sys/fs/cgroup/cpu" }; // v1, quota is -1 when not set
+	for (const std::string& dir : mrzCgroupDirs(kMountPointsV1, 2, "cpu")) {
+		FILE* file = fopen((dir + "/cpu.cfs_quota_us").c_str(), "r");
+		if (!file) {
+			continue;
+		}
+		const int count = fscanf(file, "%lld", &quotaInMicros);
+		fclose(file);
+		if ((file = fopen((dir + "/cpu.cfs_period_us").c_str(), "r"))) {
+			if (fscanf(file, "%lld", &periodInMicros) != 1) {
+				periodInMicros = 0;
+			}
+			fclose(file);
+		}
+		if (count == 1 && quotaInMicros > 0 && periodInMicros > 0) {
+			cpus = static_cast<double>(quotaInMicros) / static_cast<double>(periodInMicros);
+		}
+		return (count == 1);
+	}
+#endif /* __linux__ */
+	return false;
+}
+
+/*
+* Memory limit of the container from the cgroup files of the process: "memory.max" (v2) or "memory.limit_in_bytes" (v1).
+* Same lookup as mrzCgroupCpuQuota.
+* @param bytes The limit, zero if there is no limit.
+* @returns false if no cgroup file could be read, true otherwise
+*/
+static inline bool mrzCgroupMemoryLimit(size_t& bytes)
+{
+	bytes = 0;
+#if defined(__linux__) || ULTMRZ_SDK_OS_ANDROID
+	static const char* kMountPointsV2[] = { "/sys/fs/cgroup" };
+	static const char* kMountPointsV1[] = { "/sys/fs/cgroup/memory" };
+	std::vector<std::string> paths;
+	for (const std::string& dir : mrzCgroupDirs(kMountPointsV2, 1, nullptr)) {
+		paths.push_back(dir + "/memory.max");
+	}
+	for (const std::string& dir : mrzCgroupDirs(kMountPointsV1, 1, "memory")) {
+		paths.push_back(dir + "/memory.limit_in_bytes");
+	}
+	for (const std::string& path : paths) {
+		FILE* file = fopen(path.c_str(), "r");
+		if (!file) {
+			continue;
+		}
+		char value[32] = { 0 };
+		const int count = fscanf(file, "%31s", value);
+		fclose(file);
+		const unsigned long long limit = (count == 1 && strcmp(value, "max")) ? strtoull(value, nullptr, 10) : 0;
+		if (limit < (1ULL << 60)) { // v1 uses a huge number when not set
+			bytes = static_cast<size_t>(limit);
+		}
+		return (count == 1);
+	}
+#endif /* __linux__ */
+	return false;
+}
+
+/*
+* Number of CPUs really available to the process: the affinity mask (which also reflects the cgroup cpuset, e.g.
+* "docker --cpuset-cpus") capped by the cgroup CPU quota rounded up.
+* std::thread::hardware_concurrency() returns the number of cores of the host which leads to oversubscription and
+* throttling in containers.
+*/
+static inline size_t mrzCpuCountAvailable()
+{
+	std::vector<int> cores;
+	size_t count = mrzCpuSetCurrent(cores);
+	double quota;
+	if (mrzCgroupCpuQuota(quota) && quota > 0.0) {
+		count = std::min(count, static_cast<size_t>(ceil(quota)));
+	}
+	return std::max(count, static_cast<size_t>(1));
+}
+
+/*
+* Changes the "num_threads" value in a JSON config. The entry is appended if missing and the config is
+* not closed yet ("}" not appended), like in the samples.
+* @param jsonConfig
+* @param numThreads
+*/
+static inline void mrzConfigSetNumThreads(std::string& jsonConfig, const int numThreads)
+{
+	static const char kKey[] = "\"num_threads\"";
+	const std::string value = std::to_string(numThreads);
+	const size_t pos = jsonConfig.find(kKey);
+	if (pos == std::string::npos) {
+		jsonConfig += std::string(jsonConfig.find(':') == std::string::npos ? "" : ",") + kKey + ": " + value;
+		return;
+	}
+	size_t start = jsonConfig.find(':', pos + sizeof(kKey) - 1);
+	if (start == std::string::npos) {
+		return;
+	}
+	++start;
+	while (start < jsonConfig.size() && jsonConfig[start] == ' ') ++start;
+	size_t end = start;
+	while (end < jsonConfig.size() && jsonConfig[end] != ',' && jsonConfig[end] != '}') ++end;
+	jsonConfig.replace(start, end - start, value);
+}
+
+/*
+* Replaces "num_threads": -1 (automatic) in a JSON config with the number of CPUs available to the container
+* (mrzCpuCountAvailable) and logs the chosen value and the container limits. Other values are left untouched.
+* @param jsonConfig
+* @returns the number of threads in the config, -1 if automatic and the container limits couldn't be detected
+*/
+static inline int mrzConfigAutoNumThreads(std::string& jsonConfig)
+{
+	const size_t pos = jsonConfig.find("\"num_threads\"");
+	const size_t colon = (pos == std::string::npos) ? std::string::npos : jsonConfig.find(':', pos);
+	const int numThreads = (colon == std::string::npos) ? -1 : atoi(jsonConfig.c_str() + colon + 1);
+	if (numThreads > 0) {
+		return numThreads;
+	}
+	double quota;
+	size_t memoryLimit;
+	const bool cgroupCpu = mrzCgroupCpuQuota(quota);
+	const bool cgroupMemory = mrzCgroupMemoryLimit(memoryLimit);
+	std::vector<int> cores;
+	const size_t hostCount = static_cast<size_t>(std::thread::hardware_concurrency()), affinityCount = mrzCpuSetCurrent(cores);
+	const size_t count = mrzCpuCountAvailable();
+	char quotaStr[32] = "none";
+	if (cgroupCpu && quota > 0.0) {
+		snprintf(quotaStr, sizeof(quotaStr), "%.2f", quota);
+	}
+	ULTMRZ_SDK_PRINT_INFO("CPUs: host = %zu, affinity/cpuset = %zu, cgroup quota = %s -> num_threads = %zu",
+		hostCount, affinityCount, quotaStr, count);
+	if (cgroupMemory && memoryLimit) {
+		ULTMRZ_SDK_PRINT_INFO("cgroup memory limit = %zu KB, use mrzProcessImageWithinBudget to stay below it", memoryLimit >> 10);
+	}
+	if (count == hostCount) {
+		return -1; // no restriction, let the engine decide
+	}
+	mrzConfigSetNumThreads(jsonConfig, static_cast<int>(count));
+	return static_cast<int>(count);
+}
+
+#endif /* _ULTIMATE_MRZ_SDK_SAMPLES_CPU_H_ */
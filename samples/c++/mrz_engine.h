@@ -0,0 +1,315 @@
+/* Copyright (C) 2016-2019 Doubango Telecom <https://www.doubango.org>
+* File author: Mamadou DIOP (Doubango Telecom, France).
+* License: For non commercial use only.
+* Source code: https://github.com/DoubangoTelecom/ultimateMRZ-SDK
+* WebSite: https://www.doubango.org/webapps/mrz/
+*/
+
+#if !defined(_ULTIMATE_MRZ_SDK_SAMPLES_ENGINE_H_)
+#define _ULTIMATE_MRZ_SDK_SAMPLES_ENGINE_H_
+
+#include "mrz_utils.h"
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+typedef std::vector<std::pair<std::string, std::string> > MrzJsonEntries; // key -> raw JSON value, in order
+
+/*
+* Splits the top-level entries of a JSON object. The values are kept as raw JSON text (not decoded)
+* which means nested objects and arrays (e.g. "roi") are supported.
+* @param json
+* @param entries
+* @returns false if the JSON object is malformed, true otherwise
+*/
+static inline bool mrzJsonObjectSplit(const std::string& json, MrzJsonEntries& entries)
+{
+	entries.clear();
+	size_t i = 0;
+	const size_t n = json.size();
+	auto skipSpaces = [&]() { while (i < n && isspace(static_cast<unsigned char>(json[i]))) ++i; };
+	auto skipString = [&]() { // "i" on the opening quote, returns with "i" after the closing quote
+		for (++i; i < n && json[i] != '"'; ++i) {
+			if (json[i] == '\\') ++i;
+		}
+		return (i++ < n);
+	};
+	skipSpaces();
+	if (i >= n || json[i++] != '{') {
+		return false;
+	}
+	for (;;) {
+		skipSpaces();
+		if (i < n && json[i] == '}') {
+			return true;
+		}
+		if (i >= n || json[i] != '"') {
+			return false;
+		}
+		const size_t keyStart = i + 1;
+		if (!skipString()) {
+			return false;
+		}
+		const std::string key = json.substr(keyStart, i - keyStart - 1);
+		skipSpaces();
+		if (i >= n || json[i++] != ':') {
+			return false;
+		}
+		skipSpaces();
+		const size_t valueStart = i;
+		int depth = 0;
+		while (i < n && (depth > 0 || (json[i] != ',' && json[i] != '}'))) {
+			if (json[i] == '"') {
+				if (!skipString()) {
+					return false;
+				}
+				continue;
+			}
+			depth += (json[i] == '[' || json[i] == '{') ? 1 : ((json[i] == ']' || json[i] == '}') ? -1 : 0);
+			++i;
+		}
+		size_t valueEnd = i;
+		while (valueEnd > valueStart && isspace(static_cast<unsigned char>(json[valueEnd - 1]))) --valueEnd;
+		if (i >= n || valueEnd == valueStart) {
+			return false;
+		}
+		entries.push_back(std::make_pair(key, json.substr(valueStart, valueEnd - valueStart)));
+		if (json[i] == ',') {
+			++i;
+		}
+	}
+}
+
+/*
+* Builds a JSON object from its entries
+*/
+static inline std::string mrzJsonObjectJoin(const MrzJsonEntries& entries)
+{
+	std::string json = "{";
+	for (const std::pair<std::string, std::string>& entry : entries) {
+		json += (json.size() > 1 ? ",\"" : "\"") + entry.first + "\": " + entry.second;
+	}
+	return json + "}";
+}
+
+/*
+* Engine wrapper with runtime reconfiguration: "setConfig" could be called while other threads are calling "process".
+* The public API has no way to update the configuration of an initialized engine which means "setConfig" still
+* reinitializes it: the pending "process" calls are drained, new ones wait until the engine is ready again, then
+* the engine is warmed up (see "setWarmUp") so that the next frame doesn't pay for the models loading.
+* The stall is not removed: all threads calling "process" (e.g. your video threads) block for the whole reload
+* (deInit, init and warm-up). The warm-up only keeps the models loading out of the first frame after it:
+* switch profiles when the load changes, not for every frame.
+* The engine is a singleton: use a single instance of this class.
+*/
+class MrzEngine {
+public:
+	MrzEngine() { }
+	virtual ~MrzEngine() {
+		deInit();
+	}
+
+	/*
+	* Initializes the engine.
+	* @param assetManager Android only. The engine is reinitialized by "setConfig" (from any thread) which means
+	* the reference is kept: it must be a JNI global reference (env->NewGlobalRef), valid until "deInit" returns.
+	* A local reference, such as the one received by a native method, is only valid during that call.
+	* @param jsonConfig Full configuration, same as UltMrzSdkEngine::init.
+	* Calling it again reinitializes the engine with the new configuration (deInit then init).
+	*/
+#if ULTMRZ_SDK_OS_ANDROID
+	UltMrzSdkResult init(jobject assetManager, const char* jsonConfig) {
+#else
+	UltMrzSdkResult init(const char* jsonConfig) {
+#endif /* ULTMRZ_SDK_OS_ANDROID */
+		MrzJsonEntries config;
+		if (!mrzJsonObjectSplit(jsonConfig ? jsonConfig : "{}", config)) {
+			return UltMrzSdkResult(-1, "Malformed JSON config", "");
+		}
+		std::lock_guard<std::mutex> configLock(configMutex_);
+		WriteLock lock(*this);
+		if (initialized_) {
+			initialized_ = false;
+			UltMrzSdkEngine::deInit();
+		}
+#if ULTMRZ_SDK_OS_ANDROID
+		assetManager_ = assetManager;
+#endif /* ULTMRZ_SDK_OS_ANDROID */
+		config_.swap(config);
+		UltMrzSdkResult result = engineInit();
+		initialized_ = result.isOK();
+		return result;
+	}
+
+	UltMrzSdkResult deInit() {
+		std::lock_guard<std::mutex> configLock(configMutex_);
+		WriteLock lock(*this);
+		if (!initialized_) {
+			return UltMrzSdkResult(0, "OK", "");
+		}
+		initialized_ = false;
+		return UltMrzSdkEngine::deInit();
+	}
+
+	/*
+	* Frame sizes and types used to warm up the engine after a reconfiguration. Not warmed up if not defined.
+	*/
+	void setWarmUp(const size_t maxWidth, const size_t maxHeight, const ULTMRZ_SDK_IMAGE_TYPE* types, const size_t numTypes) {
+		std::lock_guard<std::mutex> configLock(configMutex_);
+		warmUpWidth_ = maxWidth, warmUpHeight_ = maxHeight;
+		warmUpTypes_.assign(types, types + numTypes);
+		warmUpImages_.clear();
+	}
+	/*
+	* Same as above using sample frames (at least one with an MRZ) to also warm up the recognizer, see mrzWarmUp.
+	* The image data is not copied: the memory must remain valid while the engine is in use.
+	*/
+	void setWarmUp(const MrzImage* images, const size_t numImages) {
+		std::lock_guard<std::mutex> configLock(configMutex_);
+		warmUpImages_.assign(images, images + numImages);
+		warmUpTypes_.clear();
+	}
+
+	/*
+	* Updates some configuration entries, for example {"segmenter_accuracy": "low", "min_score": 0.5}.
+	* The entries not in "jsonPatch" keep their current value. Nothing is done if the values are unchanged.
+	* Typical runtime entries: "segmenter_accuracy", "interpolation", "backpropagation_enabled", "ielcd_enabled",
+	* "min_score", "num_threads".
+	* On failure the previous configuration is restored.
+	* @param jsonPatch
+	* @returns the result of the engine initialization with the new configuration
+	*/
+	UltMrzSdkResult setConfig(const char* jsonPatch) {
+		MrzJsonEntries patch;
+		if (!mrzJsonObjectSplit(jsonPatch ? jsonPatch : "{}", patch)) {
+			return UltMrzSdkResult(-1, "Malformed JSON config", "");
+		}
+		std::lock_guard<std::mutex> configLock(configMutex_);
+		MrzJsonEntries config = config_;
+		bool changed = false;
+		for (const std::pair<std::string, std::string>& entry : patch) {
+			MrzJsonEntries::iterator it = std::find_if(config.begin(), config.end(), [&entry](const std::pair<std::string, std::string>& e) { return e.first == entry.first; });
+			if (it == config.end()) {
+				config.push_back(entry), changed = true;
+			}
+			else if (it->second != entry.second) {
+				it->second = entry.second, changed = true;
+			}
+		}
+		if (!changed || !initialized_) {
+			config_.swap(config);
+			return UltMrzSdkResult(0, "OK", "");
+		}
+
+		const std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+		WriteLock lock(*this);
+		UltMrzSdkEngine::deInit();
+		config_.swap(config);
+		UltMrzSdkResult result = engineInit();
+		if (!result.isOK()) {
+			ULTMRZ_SDK_PRINT_ERROR("New config rejected (%s), restoring the previous one", result.phrase());
+			config_.swap(config);
+			initialized_ = engineInit().isOK();
+			return result;
+		}
+		if (!warmUpImages_.empty()) {
+			mrzWarmUp(warmUpImages_.data(), warmUpImages_.size());
+		}
+		else if (!warmUpTypes_.empty()) {
+			mrzWarmUp(warmUpWidth_, warmUpHeight_, warmUpTypes_.data(), warmUpTypes_.size());
+		}
+		++reloadCount_;
+		ULTMRZ_SDK_PRINT_INFO("Config updated in %lf millis", std::chrono::duration_cast<std::chrono::duration<double> >(std::chrono::steady_clock::now() - timeStart).count() * 1000.0);
+		return result;
+	}
+
+	/*
+	* Processes an image. Could be called from any thread, blocks while a reconfiguration is in progress.
+	* Returns an error result if the engine isn't initialized (before "init", after "deInit" or a failed reload).
+	*/
+	UltMrzSdkResult process(const MrzImage& image) {
+		ReadLock lock(*this);
+		if (!initialized_) { // written only under the write lock
+			return UltMrzSdkResult(-1, "Engine not initialized", "");
+		}
+		return mrzProcessImage(image);
+	}
+
+	/*
+	* Current configuration, JSON string
+	*/
+	std::string config() const {
+		std::lock_guard<std::mutex> configLock(configMutex_);
+		return mrzJsonObjectJoin(config_);
+	}
+	inline size_t reloadCount() const {
+		return reloadCount_;
+	}
+
+private:
+	UltMrzSdkResult engineInit() {
+		const std::string json = mrzJsonObjectJoin(config_);
+#if ULTMRZ_SDK_OS_ANDROID
+		return UltMrzSdkEngine::init(assetManager_, json.c_str());
+#else
+		return UltMrzSdkEngine::init(json.c_str());
+#endif /* ULTMRZ_SDK_OS_ANDROID */
+	}
+
+	// Readers/writer gate. The writer has priority: new readers wait while a writer is waiting.
+	struct ReadLock {
+		ReadLock(MrzEngine& engine) : engine_(engine) {
+			std::unique_lock<std::mutex> lock(engine_.gateMutex_);
+			engine_.gateCond_.wait(lock, [this] { return !engine_.writing_ && !engine_.writersWaiting_; });
+			++engine_.readers_;
+		}
+		~ReadLock() {
+			std::unique_lock<std::mutex> lock(engine_.gateMutex_);
+			if (!--engine_.readers_) {
+				engine_.gateCond_.notify_all();
+			}
+		}
+		MrzEngine& engine_;
+	};
+	struct WriteLock {
+		WriteLock(MrzEngine& engine) : engine_(engine) {
+			std::unique_lock<std::mutex> lock(engine_.gateMutex_);
+			++engine_.writersWaiting_;
+			engine_.gateCond_.wait(lock, [this] { return !engine_.writing_ && !engine_.readers_; });
+			--engine_.writersWaiting_;
+			engine_.writing_ = true;
+		}
+		~WriteLock() {
+			std::unique_lock<std::mutex> lock(engine_.gateMutex_);
+			engine_.writing_ = false;
+			engine_.gateCond_.notify_all();
+		}
+		MrzEngine& engine_;
+	};
+
+private:
+#if ULTMRZ_SDK_OS_ANDROID
+	jobject assetManager_ = nullptr; // JNI global reference, owned by the caller
+#endif /* ULTMRZ_SDK_OS_ANDROID */
+	mutable std::mutex configMutex_; // serializes init, deInit and setConfig
+	MrzJsonEntries config_;
+	bool initialized_ = false;
+	std::atomic<size_t> reloadCount_{ 0 };
+	size_t warmUpWidth_ = 0;
+	size_t warmUpHeight_ = 0;
+	std::vector<ULTMRZ_SDK_IMAGE_TYPE> warmUpTypes_;
+	std::vector<MrzImage> warmUpImages_;
+
+	std::mutex gateMutex_;
+	std::condition_variable gateCond_;
+	size_t readers_ = 0;
+	size_t writersWaiting_ = 0;
+	bool writing_ = false;
+};
+
+#endif /* _ULTIMATE_MRZ_SDK_SAMPLES_ENGINE_H_ */
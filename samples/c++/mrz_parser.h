@@ -14,6 +14,8 @@
 #include <string>
 #include <regex>
 #include <sstream>
+#include <iterator>
+#include <algorithm>
 
 // Assertion function
 #if !defined(ULTMRZ_SDK_ASSERT)
@@ -85,6 +87,95 @@ static bool(*__mrz_parser_processXXXX[])(const std::vector<std::string>& lines,
 	__mrz_parser_processMRVB
 };
 
+static inline MRZ_DOCUMENT_TYPE __mrz_parser_type(const std::vector<std::string>& lines)
+{
+	if (lines.empty()) {
+		return MRZ_DOCUMENT_TYPE_UNKNOWN;
+	}
+	return (lines.size() == 3 && lines.front().size() == 30) ? MRZ_DOCUMENT_TYPE_TD1
+		: ((lines.front().size() == 44 && lines.size() == 2) ? (lines.front()[0] == 'P' ? MRZ_DOCUMENT_TYPE_TD3 : MRZ_DOCUMENT_TYPE_MRVA)
+			: ((lines.front().size() == 36 && lines.size() == 2) ? (lines.front()[0] == 'V' ? MRZ_DOCUMENT_TYPE_MRVB : MRZ_DOCUMENT_TYPE_TD2) : MRZ_DOCUMENT_TYPE_UNKNOWN));
+}
+
+// Value used to compute the check digits: '0'-'9' -> 0-9, 'A'-'Z' -> 10-35, '<' -> 0. -1 for invalid chars.
+static inline int __mrz_parser_charValue(const char c)
+{
+	return (c >= '0' && c <= '9') ? (c - '0') : ((c >= 'A' && c <= 'Z') ? (c - 'A' + 10) : (c == '<' ? 0 : -1));
+}
+
+// Weighted sum (weights 7, 3, 1) of line[start, end], "weightIndex" is updated to continue the sequence with another segment
+static inline bool __mrz_parser_weightedSum(const std::string& line, const size_t start, const size_t end, size_t& weightIndex, int& sum)
+{
+	static const int __Weights[] = { 7, 3, 1 };
+	for (size_t i = start; i <= end; ++i, ++weightIndex) {
+		const int value = __mrz_parser_charValue(line[i]);
+		if (value < 0) {
+			return false;
+		}
+		sum += value * __Weights[weightIndex % 3];
+	}
+	return true;
+}
+
+static inline bool __mrz_parser_checkDigit(const std::string& line, const size_t start, const size_t end, const size_t check)
+{
+	size_t weightIndex = 0;
+	int sum = 0;
+	return __mrz_parser_weightedSum(line, start, end, weightIndex, sum) && (sum % 10) == __mrz_parser_charValue(line[check]);
+}
+
+/*
+* Checks all the check digits defined by ICAO 9303 for the document type (document number, dates, composite...)
+* @param lines The MRZ lines
+* @returns true if the lines match a known document type and all check digits are correct, false otherwise
+*/
+static inline bool __mrz_parser_checkDigits(const std::vector<std::string>& lines)
+{
+	const MRZ_DOCUMENT_TYPE type = __mrz_parser_type(lines);
+	for (size_t i = 1; i < lines.size(); ++i) {
+		if (lines.front().size() != lines[i].size()) {
+			return false;
+		}
+	}
+	size_t weightIndex = 0;
+	int sum = 0;
+	switch (type) {
+	case MRZ_DOCUMENT_TYPE_TD1: // 9303_p5_cons_en.pdf - 4.2.4 Check digits in the MRZ
+		return __mrz_parser_checkDigit(lines[0], 5, 13, 14)
+			&& __mrz_parser_checkDigit(lines[1], 0, 5, 6)
+			&& __mrz_parser_checkDigit(lines[1], 8, 13, 14)
+			&& __mrz_parser_weightedSum(lines[0], 5, 29, weightIndex, sum)
+			&& __mrz_parser_weightedSum(lines[1], 0, 6, weightIndex, sum)
+			&& __mrz_parser_weightedSum(lines[1], 8, 14, weightIndex, sum)
+			&& __mrz_parser_weightedSum(lines[1], 18, 28, weightIndex, sum)
+			&& (sum % 10) == __mrz_parser_charValue(lines[1][29]);
+	case MRZ_DOCUMENT_TYPE_TD2: // 9303_p6_cons_en.pdf - 4.2.4 Check digits in the MRZ
+		return __mrz_parser_checkDigit(lines[1], 0, 8, 9)
+			&& __mrz_parser_checkDigit(lines[1], 13, 18, 19)
+			&& __mrz_parser_checkDigit(lines[1], 21, 26, 27)
+			&& __mrz_parser_weightedSum(lines[1], 0, 9, weightIndex, sum)
+			&& __mrz_parser_weightedSum(lines[1], 13, 19, weightIndex, sum)
+			&& __mrz_parser_weightedSum(lines[1], 21, 34, weightIndex, sum)
+			&& (sum % 10) == __mrz_parser_charValue(lines[1][35]);
+	case MRZ_DOCUMENT_TYPE_TD3: // 9303_p4_cons_en.pdf - 4.2.4 Check digits in the MRZ
+		return __mrz_parser_checkDigit(lines[1], 0, 8, 9)
+			&& __mrz_parser_checkDigit(lines[1], 13, 18, 19)
+			&& __mrz_parser_checkDigit(lines[1], 21, 26, 27)
+			&& __mrz_parser_checkDigit(lines[1], 28, 41, 42)
+			&& __mrz_parser_weightedSum(lines[1], 0, 9, weightIndex, sum)
+			&& __mrz_parser_weightedSum(lines[1], 13, 19, weightIndex, sum)
+			&& __mrz_parser_weightedSum(lines[1], 21, 42, weightIndex, sum)
+			&& (sum % 10) == __mrz_parser_charValue(lines[1][43]);
+	case MRZ_DOCUMENT_TYPE_MRVA:
+	case MRZ_DOCUMENT_TYPE_MRVB: // 9303_p7_cons_en.pdf
+		return __mrz_parser_checkDigit(lines[1], 0, 8, 9)
+			&& __mrz_parser_checkDigit(lines[1], 13, 18, 19)
+			&& __mrz_parser_checkDigit(lines[1], 21, 26, 27);
+	default:
+		return false;
+	}
+}
+
 static bool __mrz_parser_process(const std::vector<std::string>& lines, MrzData& data)
 {
 	// Make sure we have 2 or 3 lines
@@ -102,10 +193,7 @@ static bool __mrz_parser_process(const std::vector<std::string>& lines, MrzData&
 	}
 
 	// Get type
-	data.type =
-		(lines.size() == 3 && lines.front().size() == 30) ? MRZ_DOCUMENT_TYPE_TD1
-		: ((lines.front().size() == 44 && lines.size() == 2) ? (lines.front()[0] == 'P' ? MRZ_DOCUMENT_TYPE_TD3 : MRZ_DOCUMENT_TYPE_MRVA)
-			: ((lines.front().size() == 36 && lines.size() == 2) ? (lines.front()[0] == 'V' ? MRZ_DOCUMENT_TYPE_MRVB : MRZ_DOCUMENT_TYPE_TD2) : MRZ_DOCUMENT_TYPE_UNKNOWN));
+	data.type = __mrz_parser_type(lines);
 	if (data.type == MRZ_DOCUMENT_TYPE_UNKNOWN) {
 		ULTMRZ_SDK_PRINT_FATAL("Invalid type");
 		return false;
@@ -0,0 +1,40 @@
+/* Copyright (C) 2016-2019 Doubango Telecom <https://www.doubango.org>
+* File author: Mamadou DIOP (Doubango Telecom, France).
+* License: For non commercial use only.
+* Source code: https://github.com/DoubangoTelecom/ultimateMRZ-SDK
+* WebSite: https://www.doubango.org/webapps/mrz/
+*/
+
+#if !defined(_ULTIMATE_MRZ_SDK_SAMPLES_PROBES_H_)
+#define _ULTIMATE_MRZ_SDK_SAMPLES_PROBES_H_
+
+/*
+* USDT (user-level statically defined tracing) probes for Linux, provider "ultimateMrzSdk".
+* A probe is a single "nop" instruction until a tracer (perf, bpftrace, SystemTap...) attaches to it,
+* which means they could be left in production builds. Requires <sys/sdt.h> ("systemtap-sdt-dev" package
+* on Debian/Ubuntu, "systemtap-sdt-devel" on Fedora) otherwise the probes are compiled out.
+* Define MRZ_PROBES_DISABLED to always compile them out.
+*
+* Probes (arguments in order):
+*	process__entry: width, height, image type
+*	process__return: result code, number of zones
+*	zone: frame id, zone index, number of lines
+*
+* List them with "readelf -n <binary>" or "bpftrace -l 'usdt:<binary>:*'".
+*/
+#if defined(__linux__) && !defined(MRZ_PROBES_DISABLED) && defined(__has_include)
+#	if __has_include(<sys/sdt.h>)
+#		include <sys/sdt.h>
+#		define MRZ_PROBES_ENABLED 1
+#	endif
+#endif
+
+#if defined(MRZ_PROBES_ENABLED)
+#	define MRZ_PROBE2(name, arg1, arg2)			DTRACE_PROBE2(ultimateMrzSdk, name, arg1, arg2)
+#	define MRZ_PROBE3(name, arg1, arg2, arg3)	DTRACE_PROBE3(ultimateMrzSdk, name, arg1, arg2, arg3)
+#else
+#	define MRZ_PROBE2(name, arg1, arg2)			((void)0)
+#	define MRZ_PROBE3(name, arg1, arg2, arg3)	((void)0)
+#endif
+
+#endif /* _ULTIMATE_MRZ_SDK_SAMPLES_PROBES_H_ */
@@ -0,0 +1,257 @@
+/* Copyright (C) 2016-2019 Doubango Telecom <https://www.doubango.org>
+* File author: Mamadou DIOP (Doubango Telecom, France).
+* License: For non commercial use only.
+* Source code: https://github.com/DoubangoTelecom/ultimateMRZ-SDK
+* WebSite: https://www.doubango.org/webapps/mrz/
+*/
+
+#if !defined(_ULTIMATE_MRZ_SDK_SAMPLES_RESULT_H_)
+#define _ULTIMATE_MRZ_SDK_SAMPLES_RESULT_H_
+
+#include <ultimateMRZ-SDK-API-PUBLIC.h>
+#include "mrz_probes.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define MRZ_RESULT_MAX_LINE_LENGTH		44 // TD3 (passports)
+
+/*
+* MRZ line. Plain old data: the text is stored inline.
+*/
+struct MrzLine {
+	char text[MRZ_RESULT_MAX_LINE_LENGTH + 1]; // null-terminated
+	size_t textLength;
+	float confidence;
+	float warpedBox[8]; // (x, y) for the 4 corners, -1.0 values when using the trial version
+};
+
+/*
+* MRZ zone. Plain old data: the lines are at [lineIndex, lineIndex + numLines) in MrzResult::lines.
+*/
+struct MrzZone {
+	float warpedBox[8];
+	size_t lineIndex;
+	size_t numLines;
+};
+
+/*
+* Structured view of the JSON result. All zones are in a single array and all lines in
+* another one. Both arrays keep their capacity when the object is reused which means
+* decoding results at video rate doesn't allocate memory once the largest result is seen.
+*/
+struct MrzResult {
+	int64_t frameId = -1;
+	double duration = 0.0; // time spent by the engine, in milliseconds
+	std::vector<MrzZone> zones;
+	std::vector<MrzLine> lines;
+
+	void clear() {
+		frameId = -1;
+		duration = 0.0;
+		zones.clear();
+		lines.clear();
+	}
+	inline const MrzLine* zoneLines(const MrzZone& zone) const { // nullptr if the zone has no line
+		return zone.numLines ? (lines.data() + zone.lineIndex) : nullptr;
+	}
+};
+
+/*
+* Minimal single-pass decoder for the JSON result returned by the engine.
+* Unknown keys are skipped.
+*/
+class MrzResultDecoder {
+public:
+	static bool decode(const char* json, MrzResult& result) {
+		result.clear();
+		if (!json || !*json) {
+			return true; // bodyless result
+		}
+		MrzResultDecoder decoder(json);
+		if (!decoder.decodeResult(result)) {
+			ULTMRZ_SDK_PRINT_ERROR("Failed to decode JSON result at offset %zu", static_cast<size_t>(decoder.ptr_ - json));
+			result.clear();
+			return false;
+		}
+		return true;
+	}
+
+private:
+	MrzResultDecoder(const char* json) : ptr_(json) { }
+
+	inline void skipSpaces() {
+		while (*ptr_ == ' ' || *ptr_ == '\t' || *ptr_ == '\n' || *ptr_ == '\r') ++ptr_;
+	}
+	inline bool expect(const char c) {
+		skipSpaces();
+		if (*ptr_ != c) return false;
+		++ptr_;
+		return true;
+	}
+	// Returns true if there is another member/element, false at the end of the object/array
+	inline bool next(const char endChar, bool& first, bool& ok) {
+		skipSpaces();
+		if (*ptr_ == endChar) { ++ptr_; return false; }
+		if (!first && !expect(',')) { ok = false; return false; }
+		first = false;
+		return true;
+	}
+	bool readString(char* out, const size_t outSize, size_t* outLength = nullptr) {
+		if (!expect('"')) return false;
+		size_t length = 0;
+		while (*ptr_ && *ptr_ != '"') {
+			char c = *ptr_++;
+			if (c == '\\') {
+				if (!*ptr_) return false;
+				c = *ptr_++;
+				if (c == 'u') { // not expected in MRZ data, keep a placeholder
+					for (int i = 0; i < 4 && *ptr_; ++i) ++ptr_;
+					c = '?';
+				}
+			}
+			if (out && length + 1 < outSize) out[length] = c;
+			++length;
+		}
+		if (!expect('"')) return false;
+		if (out && outSize) {
+			out[length < outSize ? length : (outSize - 1)] = '\0';
+		}
+		if (outLength) *outLength = (out && length >= outSize) ? (outSize - 1) : length;
+		return true;
+	}
+	bool readNumber(double& value) {
+		skipSpaces();
+		char* end = nullptr;
+		value = strtod(ptr_, &end);
+		if (end == ptr_) return false;
+		ptr_ = end;
+		return true;
+	}
+	bool readKey(char* key, const size_t keySize) {
+		return readString(key, keySize) && expect(':');
+	}
+	bool readBox(float box[8]) {
+		if (!expect('[')) return false;
+		bool first = true, ok = true;
+		size_t count = 0;
+		while (next(']', first, ok)) {
+			double value;
+			if (!readNumber(value)) return false;
+			if (count < 8) box[count] = static_cast<float>(value);
+			++count;
+		}
+		return ok && count == 8;
+	}
+	bool skipValue() {
+		skipSpaces();
+		bool first = true, ok = true;
+		switch (*ptr_) {
+		case '"': return readString(nullptr, 0);
+		case '{':
+			++ptr_;
+			while (next('}', first, ok)) {
+				if (!readKey(nullptr, 0) || !skipValue()) return false;
+			}
+			return ok;
+		case '[':
+			++ptr_;
+			while (next(']', first, ok)) {
+				if (!skipValue()) return false;
+			}
+			return ok;
+		case 't': case 'f': case 'n':
+			while (*ptr_ >= 'a' && *ptr_ <= 'z') ++ptr_;
+			return true;
+		default:
+			double value;
+			return readNumber(value);
+		}
+	}
+	bool decodeLine(MrzLine& line) {
+		memset(&line, 0, sizeof(line));
+		if (!expect('{')) return false;
+		bool first = true, ok = true;
+		char key[16];
+		while (next('}', first, ok)) {
+			if (!readKey(key, sizeof(key))) return false;
+			double value;
+			if (!strcmp(key, "text")) { if (!readString(line.text, sizeof(line.text), &line.textLength)) return false; }
+			else if (!strcmp(key, "confidence")) { if (!readNumber(value)) return false; line.confidence = static_cast<float>(value); }
+			else if (!strcmp(key, "warpedBox")) { if (!readBox(line.warpedBox)) return false; }
+			else if (!skipValue()) return false;
+		}
+		return ok;
+	}
+	bool decodeZone(MrzResult& result) {
+		MrzZone zone;
+		memset(&zone, 0, sizeof(zone));
+		zone.lineIndex = result.lines.size();
+		if (!expect('{')) return false;
+		bool first = true, ok = true;
+		char key[16];
+		while (next('}', first, ok)) {
+			if (!readKey(key, sizeof(key))) return false;
+			if (!strcmp(key, "lines")) {
+				if (!expect('[')) return false;
+				bool firstLine = true;
+				while (next(']', firstLine, ok)) {
+					result.lines.resize(result.lines.size() + 1);
+					if (!decodeLine(result.lines.back())) return false;
+				}
+				if (!ok) return false;
+			}
+			else if (!strcmp(key, "warpedBox")) { if (!readBox(zone.warpedBox)) return false; }
+			else if (!skipValue()) return false;
+		}
+		zone.numLines = result.lines.size() - zone.lineIndex;
+		result.zones.push_back(zone);
+		return ok;
+	}
+	bool decodeResult(MrzResult& result) {
+		if (!expect('{')) return false;
+		bool first = true, ok = true;
+		char key[16];
+		while (next('}', first, ok)) {
+			if (!readKey(key, sizeof(key))) return false;
+			double value;
+			if (!strcmp(key, "frame_id")) { if (!readNumber(value)) return false; result.frameId = static_cast<int64_t>(value); }
+			else if (!strcmp(key, "duration")) { if (!readNumber(value)) return false; result.duration = value; }
+			else if (!strcmp(key, "zones")) {
+				if (!expect('[')) return false;
+				bool firstZone = true;
+				while (next(']', firstZone, ok)) {
+					if (!decodeZone(result)) return false;
+				}
+				if (!ok) return false;
+			}
+			else if (!skipValue()) return false;
+		}
+		return ok;
+	}
+
+private:
+	const char* ptr_;
+};
+
+/*
+* Decodes the JSON content of an engine result
+* @param result
+* @param mrzResult
+* @returns false if the JSON content is malformed, true otherwise
+*/
+static inline bool mrzResultDecode(const ultimateMrzSdk::UltMrzSdkResult& result, MrzResult& mrzResult)
+{
+	if (!MrzResultDecoder::decode(result.json(), mrzResult)) {
+		return false;
+	}
+#if defined(MRZ_PROBES_ENABLED)
+	for (size_t i = 0; i < mrzResult.zones.size(); ++i) {
+		MRZ_PROBE3(zone, mrzResult.frameId, i, mrzResult.zones[i].numLines);
+	}
+#endif /* MRZ_PROBES_ENABLED */
+	return true;
+}
+
+#endif /* _ULTIMATE_MRZ_SDK_SAMPLES_RESULT_H_ */
@@ -0,0 +1,248 @@
+/* Copyright (C) 2016-2019 Doubango Telecom <https://www.doubango.org>
+* File author: Mamadou DIOP (Doubango Telecom, France).
+* License: For non commercial use only.
+* Source code: https://github.com/DoubangoTelecom/ultimateMRZ-SDK
+* WebSite: https://www.doubango.org/webapps/mrz/
+*/
+
+#if !defined(_ULTIMATE_MRZ_SDK_SAMPLES_ROI_H_)
+#define _ULTIMATE_MRZ_SDK_SAMPLES_ROI_H_
+
+#include "mrz_utils.h"
+#include "mrz_result.h"
+#include "mrz_parser.h"
+#include <float.h>
+
+/*
+* Moves all the boxes in a result by (dx, dy). Used to map results computed on a window back to the full frame.
+* The trial version returns -1.0 for the line boxes: these ones are left untouched.
+*/
+static inline void mrzResultTranslate(MrzResult& mrzResult, const float dx, const float dy)
+{
+	for (MrzZone& zone : mrzResult.zones) {
+		for (size_t i = 0; i < 8; i += 2) {
+			zone.warpedBox[i] += dx, zone.warpedBox[i + 1] += dy;
+		}
+	}
+	for (MrzLine& line : mrzResult.lines) {
+		if (line.warpedBox[7] == -1.f) {
+			continue;
+		}
+		for (size_t i = 0; i < 8; i += 2) {
+			line.warpedBox[i] += dx, line.warpedBox[i + 1] += dy;
+		}
+	}
+}
+
+/*
+* Appends the zones and lines of "other" to "mrzResult"
+*/
+static inline void mrzResultAppend(MrzResult& mrzResult, const MrzResult& other)
+{
+	const size_t lineOffset = mrzResult.lines.size();
+	mrzResult.lines.insert(mrzResult.lines.end(), other.lines.begin(), other.lines.end());
+	for (MrzZone zone : other.zones) {
+		zone.lineIndex += lineOffset;
+		mrzResult.zones.push_back(zone);
+	}
+	mrzResult.duration += other.duration;
+	if (other.frameId >= 0) {
+		mrzResult.frameId = other.frameId;
+	}
+}
+
+/*
+* Computes the axis-aligned bounds (left, top, right, bottom) of a quadrilateral using the same
+* layout as the "warpedBox" entries: (x, y) for the 4 corners.
+* @param quad
+* @param padding Padding added on all sides, relative to the quad width.
+* @param image Used to clip the bounds.
+* @param bounds
+*/
+static inline void mrzQuadBounds(const float quad[8], const float padding, const MrzImage& image, float bounds[4])
+{
+	float left = FLT_MAX, top = FLT_MAX, right = -FLT_MAX, bottom = -FLT_MAX;
+	for (size_t i = 0; i < 8; i += 2) {
+		left = std::min(left, quad[i]), right = std::max(right, quad[i]);
+		top = std::min(top, quad[i + 1]), bottom = std::max(bottom, quad[i + 1]);
+	}
+	const float pad = (right - left) * padding;
+	bounds[0] = std::max(0.f, left - pad);
+	bounds[1] = std::max(0.f, top - pad);
+	bounds[2] = std::min(static_cast<float>(image.width), right + pad);
+	bounds[3] = std::min(static_cast<float>(image.height), bottom + pad);
+}
+
+/*
+* Processes a window of an image (no pixel copy) and decodes the result in full image coordinates.
+* @param image
+* @param bounds The window (left, top, right, bottom).
+* @param result The engine result. The JSON content is relative to the window.
+* @param mrzResult The decoded result, in full image coordinates.
+* @returns true if the window was processed and decoded, false otherwise
+*/
+static inline bool mrzProcessWindow(const MrzImage& image, const float bounds[4], UltMrzSdkResult& result, MrzResult& mrzResult)
+{
+	size_t x = static_cast<size_t>(std::max(0.f, bounds[0])), y = static_cast<size_t>(std::max(0.f, bounds[1]));
+	const size_t width = static_cast<size_t>(std::max(0.f, bounds[2] - static_cast<float>(x)));
+	const size_t height = static_cast<size_t>(std::max(0.f, bounds[3] - static_cast<float>(y)));
+	MrzImage window;
+	if (!mrzImageCrop(image, x, y, width, height, window)) {
+		mrzResult.clear();
+		return false;
+	}
+	result = mrzProcessImage(window);
+	if (!result.isOK() || !mrzResultDecode(result, mrzResult)) {
+		mrzResult.clear();
+		return false;
+	}
+	mrzResultTranslate(mrzResult, static_cast<float>(x), static_cast<float>(y));
+	return true;
+}
+
+/*
+* Per-call hints. Unlike the "roi" and "min_num_lines" configuration entries these ones could change for each frame
+* without deinitializing the engine.
+*/
+struct MrzHints {
+	float roi[4] = { 0.f, 0.f, 0.f, 0.f }; // (left, top, right, bottom) in samples, all zeros means full frame
+	MRZ_DOCUMENT_TYPE documentType = MRZ_DOCUMENT_TYPE_UNKNOWN; // unknown means any type
+
+	inline bool hasRoi() const {
+		return (roi[2] > roi[0] && roi[3] > roi[1]);
+	}
+};
+
+/*
+* Number of lines and line length for a document type (9303 layouts)
+* @returns false if the type is unknown, true otherwise
+*/
+static inline bool mrzDocumentLayout(const MRZ_DOCUMENT_TYPE type, size_t& numLines, size_t& lineLength)
+{
+	switch (type) {
+	case MRZ_DOCUMENT_TYPE_TD1: numLines = 3, lineLength = 30; return true;
+	case MRZ_DOCUMENT_TYPE_TD2: case MRZ_DOCUMENT_TYPE_MRVB: numLines = 2, lineLength = 36; return true;
+	case MRZ_DOCUMENT_TYPE_TD3: case MRZ_DOCUMENT_TYPE_MRVA: numLines = 2, lineLength = 44; return true;
+	default: return false;
+	}
+}
+
+/*
+* Removes the zones not matching a layout
+* @param mrzResult
+* @param numLines
+* @param lineLength
+*/
+static inline void mrzResultFilterLayout(MrzResult& mrzResult, const size_t numLines, const size_t lineLength)
+{
+	size_t zoneCount = 0, lineCount = 0;
+	for (size_t i = 0; i < mrzResult.zones.size(); ++i) {
+		MrzZone zone = mrzResult.zones[i];
+		bool match = (zone.numLines == numLines);
+		for (size_t j = 0; match && j < zone.numLines; ++j) {
+			match = (mrzResult.lines[zone.lineIndex + j].textLength == lineLength);
+		}
+		if (!match) {
+			continue;
+		}
+		// Compact in place, the destination is always before or at the source
+		for (size_t j = 0; j < zone.numLines; ++j) {
+			mrzResult.lines[lineCount + j] = mrzResult.lines[zone.lineIndex + j];
+		}
+		zone.lineIndex = lineCount;
+		lineCount += zone.numLines;
+		mrzResult.zones[zoneCount++] = zone;
+	}
+	mrzResult.zones.resize(zoneCount);
+	mrzResult.lines.resize(lineCount);
+}
+
+/*
+* Processes a frame using per-call hints: only the region of interest is processed (no pixel copy) and
+* the zones not matching the expected document layout are dropped.
+* @param image
+* @param hints
+* @param result The engine result. The JSON content is relative to the region of interest and not filtered.
+* @param mrzResult The decoded and filtered result, in full image coordinates.
+* @returns true if the frame was processed and decoded, false otherwise
+*/
+static inline bool mrzProcessWithHints(const MrzImage& image, const MrzHints& hints, UltMrzSdkResult& result, MrzResult& mrzResult)
+{
+	if (hints.hasRoi()) {
+		if (!mrzProcessWindow(image, hints.roi, result, mrzResult)) {
+			return false;
+		}
+	}
+	else {
+		result = mrzProcessImage(image);
+		if (!result.isOK() || !mrzResultDecode(result, mrzResult)) {
+			mrzResult.clear();
+			return false;
+		}
+	}
+	size_t numLines, lineLength;
+	if (mrzDocumentLayout(hints.documentType, numLines, lineLength)) {
+		mrzResultFilterLayout(mrzResult, numLines, lineLength);
+	}
+	return true;
+}
+
+/*
+* Recognizes MRZ zones already localized by an upstream detector. Only a window around each
+* quadrilateral is processed: the full frame detection cost is removed.
+* Only EXIF orientation equal to 1 is supported.
+* @param image
+* @param quads "numQuads" quadrilaterals, 8 floats each, same layout as the "warpedBox" entries.
+* @param numQuads
+* @param results One engine result per quadrilateral.
+* @param mrzResult All zones found, in full image coordinates.
+* @param padding Padding added around each quadrilateral, relative to its width.
+* @returns true if all quadrilaterals were processed, false otherwise
+*/
+static inline bool mrzProcessQuads(const MrzImage& image, const float* quads, const size_t numQuads, std::vector<UltMrzSdkResult>& results, MrzResult& mrzResult, const float padding = 0.05f)
+{
+	ULTMRZ_SDK_ASSERT(quads != nullptr || !numQuads);
+	mrzResult.clear();
+	if (results.size() < numQuads) {
+		results.resize(numQuads);
+	}
+	MrzResult windowResult;
+	float bounds[4];
+	bool allOK = true;
+	for (size_t i = 0; i < numQuads; ++i) {
+		mrzQuadBounds(&quads[i << 3], padding, image, bounds);
+		if (mrzProcessWindow(image, bounds, results[i], windowResult)) {
+			mrzResultAppend(mrzResult, windowResult);
+		}
+		else {
+			allOK = false;
+		}
+	}
+	return allOK;
+}
+
+/*
+* Recognizes already rectified MRZ strips (e.g. provided by partner systems).
+* @param strips
+* @param count
+* @param results One engine result per strip.
+* @param mrzResult All zones found, appended in strip order. The boxes are relative to their strip.
+* @returns true if all strips were processed, false otherwise
+*/
+static inline bool mrzProcessStrips(const MrzImage* strips, const size_t count, std::vector<UltMrzSdkResult>& results, MrzResult& mrzResult)
+{
+	mrzResult.clear();
+	bool allOK = mrzProcessBatch(strips, count, results);
+	MrzResult stripResult;
+	for (size_t i = 0; i < count; ++i) {
+		if (results[i].isOK() && mrzResultDecode(results[i], stripResult)) {
+			mrzResultAppend(mrzResult, stripResult);
+		}
+		else {
+			allOK = false;
+		}
+	}
+	return allOK;
+}
+
+#endif /* _ULTIMATE_MRZ_SDK_SAMPLES_ROI_H_ */
@@ -0,0 +1,227 @@
+/* Copyright (C) 2016-2019 Doubango Telecom <https://www.doubango.org>
+* File author: Mamadou DIOP (Doubango Telecom, France).
+* License: For non commercial use only.
+* Source code: https://github.com/DoubangoTelecom/ultimateMRZ-SDK
+* WebSite: https://www.doubango.org/webapps/mrz/
+*/
+
+#if !defined(_ULTIMATE_MRZ_SDK_SAMPLES_SCHEDULER_H_)
+#define _ULTIMATE_MRZ_SDK_SAMPLES_SCHEDULER_H_
+
+#include "mrz_utils.h"
+#include "mrz_stats.h"
+#include "mrz_async.h"
+#include <stdint.h>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/*
+* What to do when a frame is submitted while the queue is full
+*/
+enum MRZ_DROP_POLICY {
+	MRZ_DROP_POLICY_DROP_OLDEST, // the oldest queued frame is dropped: latest frame wins (same as Android's acquireLatestImage)
+	MRZ_DROP_POLICY_DROP_NEWEST, // the submitted frame is dropped
+	MRZ_DROP_POLICY_BLOCK // the caller waits until a slot is available (no frame lost, latency grows under load)
+};
+
+/*
+* Result delivered by the frame scheduler
+*/
+struct MrzScheduledResult {
+	int64_t frameId = -1; // "frame_id" from the JSON result, -1 if not available
+	uint64_t sequence = 0; // submission index, starts at zero
+	uint64_t latencyInMicros = 0; // from capture to result
+	UltMrzSdkResult result;
+};
+
+typedef std::function<void(const MrzScheduledResult& scheduledResult)> MrzScheduledCallback;
+typedef std::function<void(const MrzImage& image, const uint64_t sequence)> MrzDropCallback; // release the frame memory here
+
+/*
+* Counters of the frame scheduler
+*/
+struct MrzSchedulerCounters {
+	uint64_t submitted;
+	uint64_t processed;
+	uint64_t droppedOldest;
+	uint64_t droppedNewest;
+	uint64_t discarded; // queued frames not processed because the scheduler was stopped
+	uint64_t latencyP50InMicros; // capture to result
+	uint64_t latencyP95InMicros;
+	uint64_t latencyP99InMicros;
+	size_t queued;
+};
+
+/*
+* Frame submission queue for live sources (cameras, RTSP streams...): frames are processed on a worker thread
+* in submission order and a bounded number of them is queued. When the queue is full the "policy" decides which
+* frame is dropped, if any. With a depth of 1 and MRZ_DROP_POLICY_DROP_OLDEST the engine always processes the most
+* recent frame and the latency doesn't build up when the source is faster than the engine.
+* Works with all image formats supported by UltMrzSdkEngine::process (see MrzImage).
+* The image data is not copied: the memory must remain valid until the result callback or the drop callback is called.
+*/
+class MrzFrameScheduler {
+public:
+	/*
+	* @param callback Function called on the worker thread for each processed frame.
+	* @param policy
+	* @param depth Maximum number of queued frames, not counting the one being processed.
+	* @param dropCallback Optional function called for each dropped frame: on the submitting thread, or on the thread
+	* calling "stop" (or the destructor) for the frames still queued at shutdown.
+	*/
+	MrzFrameScheduler(MrzScheduledCallback callback, const MRZ_DROP_POLICY policy = MRZ_DROP_POLICY_DROP_OLDEST, const size_t depth = 1, MrzDropCallback dropCallback = nullptr)
+		: callback_(std::move(callback)), dropCallback_(std::move(dropCallback)), policy_(policy), depth_(depth ? depth : 1)
+	{
+		ULTMRZ_SDK_ASSERT(callback_ != nullptr);
+		worker_ = std::thread(&MrzFrameScheduler::run, this);
+	}
+	virtual ~MrzFrameScheduler() {
+		stop();
+	}
+
+	/*
+	* Submits a frame.
+	* @param image
+	* @param captureTimeInMicros Capture time of the frame, using the same clock as MrzStats::nowInMicros() (steady clock).
+	* Negative means now.
+	* @returns false if the frame was dropped (MRZ_DROP_POLICY_DROP_NEWEST) or the scheduler is stopped, true otherwise
+	*/
+	bool submit(const MrzImage& image, const int64_t captureTimeInMicros = -1) {
+		ULTMRZ_SDK_ASSERT(image.isValid());
+		Frame frame{ image, captureTimeInMicros >= 0 ? captureTimeInMicros : MrzStats::nowInMicros(), 0 };
+		Frame dropped;
+		bool hasDropped = false;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			if (policy_ == MRZ_DROP_POLICY_BLOCK) {
+				condSlot_.wait(lock, [this] { return stopped_ || frames_.size() < depth_; });
+			}
+			if (stopped_) {
+				return false;
+			}
+			frame.sequence = submitted_++;
+			if (frames_.size() >= depth_) {
+				if (policy_ == MRZ_DROP_POLICY_DROP_NEWEST) {
+					++droppedNewest_;
+					lock.unlock();
+					if (dropCallback_) {
+						dropCallback_(frame.image, frame.sequence);
+					}
+					return false;
+				}
+				dropped = frames_.front(), hasDropped = true;
+				frames_.pop_front();
+				++droppedOldest_;
+			}
+			frames_.push_back(frame);
+		}
+		condFrame_.notify_one();
+		if (hasDropped && dropCallback_) {
+			dropCallback_(dropped.image, dropped.sequence);
+		}
+		return true;
+	}
+
+	/*
+	* Stops the worker. The frame being processed is completed, the queued ones are discarded: they're counted
+	* in "discarded" (not as dropped by the policy) and the drop callback is called for them on this thread.
+	*/
+	void stop() {
+		std::deque<Frame> dropped;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			if (stopped_) {
+				return;
+			}
+			stopped_ = true;
+			dropped.swap(frames_);
+			discarded_ += dropped.size();
+		}
+		condFrame_.notify_all();
+		condSlot_.notify_all();
+		worker_.join();
+		if (dropCallback_) {
+			for (const Frame& frame : dropped) {
+				dropCallback_(frame.image, frame.sequence);
+			}
+		}
+	}
+
+	MrzSchedulerCounters counters() const {
+		MrzSchedulerCounters counters;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			counters.submitted = submitted_;
+			counters.processed = processed_;
+			counters.droppedOldest = droppedOldest_;
+			counters.droppedNewest = droppedNewest_;
+			counters.discarded = discarded_;
+			counters.queued = frames_.size();
+		}
+		counters.latencyP50InMicros = latency_.percentile(50.0);
+		counters.latencyP95InMicros = latency_.percentile(95.0);
+		counters.latencyP99InMicros = latency_.percentile(99.0);
+		return counters;
+	}
+
+private:
+	struct Frame {
+		MrzImage image;
+		int64_t captureTime; // microseconds
+		uint64_t sequence;
+	};
+
+	void run() {
+		MrzScheduledResult scheduledResult;
+		for (;;) {
+			Frame frame;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				condFrame_.wait(lock, [this] { return stopped_ || !frames_.empty(); });
+				if (stopped_) {
+					return;
+				}
+				frame = frames_.front();
+				frames_.pop_front();
+			}
+			condSlot_.notify_one();
+			{
+				MrzTraceScope traceScope("process");
+				scheduledResult.result = mrzProcessImage(frame.image);
+				scheduledResult.frameId = mrzJsonFrameId(scheduledResult.result.json());
+				traceScope.setFrameId(scheduledResult.frameId);
+			}
+			scheduledResult.sequence = frame.sequence;
+			scheduledResult.latencyInMicros = static_cast<uint64_t>(std::max(MrzStats::nowInMicros() - frame.captureTime, int64_t(0)));
+			latency_.record(scheduledResult.latencyInMicros);
+			callback_(scheduledResult);
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				++processed_;
+			}
+		}
+	}
+
+private:
+	const MrzScheduledCallback callback_;
+	const MrzDropCallback dropCallback_;
+	const MRZ_DROP_POLICY policy_;
+	const size_t depth_;
+	std::deque<Frame> frames_;
+	bool stopped_ = false;
+	uint64_t submitted_ = 0;
+	uint64_t processed_ = 0;
+	uint64_t droppedOldest_ = 0;
+	uint64_t droppedNewest_ = 0;
+	uint64_t discarded_ = 0;
+	MrzHistogram latency_;
+	std::thread worker_;
+	mutable std::mutex mutex_;
+	std::condition_variable condFrame_;
+	std::condition_variable condSlot_;
+};
+
+#endif /* _ULTIMATE_MRZ_SDK_SAMPLES_SCHEDULER_H_ */
@@ -0,0 +1,155 @@
+/* Copyright (C) 2016-2019 Doubango Telecom <https://www.doubango.org>
+* File author: Mamadou DIOP (Doubango Telecom, France).
+* License: For non commercial use only.
+* Source code: https://github.com/DoubangoTelecom/ultimateMRZ-SDK
+* WebSite: https://www.doubango.org/webapps/mrz/
+*/
+
+#if !defined(_ULTIMATE_MRZ_SDK_SAMPLES_SESSION_H_)
+#define _ULTIMATE_MRZ_SDK_SAMPLES_SESSION_H_
+
+#include "mrz_result.h"
+#include "mrz_parser.h"
+#include <string.h>
+
+#define MRZ_SESSION_MAX_LINES		3
+#define MRZ_SESSION_NUM_CLASSES		37 // '0'-'9', 'A'-'Z' and '<'
+
+/*
+* Multi-frame session: fuses the lines recognized on consecutive frames of the same document and
+* declares the read final as soon as all ICAO check digits pass with enough margin.
+* The engine doesn't expose per-character confidences: each character votes with the confidence of its line.
+* Only the first zone of each frame is used, frames with a different layout (number of lines, length) than
+* the first accepted one are ignored.
+*
+* Usage:
+* \code{.cpp}
+* session.beginSession();
+* while (!session.feed(mrzResult)) { ... process next frame ... }
+* session.endSession(lines);
+* \endcode
+*/
+class MrzSession {
+public:
+	/*
+	* @param minFrames Minimum number of accepted frames before the read could be final.
+	* @param minMargin Minimum margin, within [0, 1], between the best and second best votes for every character.
+	*/
+	MrzSession(const size_t minFrames = 2, const float minMargin = 0.5f)
+		: minFrames_(minFrames ? minFrames : 1), minMargin_(minMargin) {
+		beginSession();
+	}
+
+	void beginSession() {
+		numLines_ = 0;
+		lineLength_ = 0;
+		numFrames_ = 0;
+		final_ = false;
+		memset(votes_, 0, sizeof(votes_));
+	}
+
+	/*
+	* Adds the result of a frame to the session.
+	* @param mrzResult
+	* @returns true if the read is final, false if more frames are needed
+	*/
+	bool feed(const MrzResult& mrzResult) {
+		if (final_ || mrzResult.zones.empty()) {
+			return final_;
+		}
+		const MrzZone& zone = mrzResult.zones.front();
+		const MrzLine* lines = mrzResult.zoneLines(zone);
+		if (zone.numLines < 2 || zone.numLines > MRZ_SESSION_MAX_LINES) {
+			return false;
+		}
+		if (!numFrames_) {
+			numLines_ = zone.numLines;
+			lineLength_ = lines[0].textLength;
+		}
+		for (size_t i = 0; i < zone.numLines; ++i) {
+			if (zone.numLines != numLines_ || lines[i].textLength != lineLength_) {
+				return false;
+			}
+		}
+		for (size_t i = 0; i < numLines_; ++i) {
+			const float weight = std::max(lines[i].confidence, 1.f);
+			for (size_t j = 0; j < lineLength_; ++j) {
+				const int klass = classIndex(lines[i].text[j]);
+				if (klass >= 0) {
+					votes_[i][j][klass] += weight;
+				}
+			}
+		}
+		++numFrames_;
+
+		if (numFrames_ >= minFrames_) {
+			std::vector<std::string> fused;
+			final_ = (fuse(fused) >= minMargin_) && __mrz_parser_checkDigits(fused);
+		}
+		return final_;
+	}
+
+	/*
+	* Ends the session.
+	* @param lines The fused lines.
+	* @returns true if the check digits of the fused lines are correct, false otherwise
+	*/
+	bool endSession(std::vector<std::string>& lines) {
+		fuse(lines);
+		const bool valid = final_ || __mrz_parser_checkDigits(lines);
+		beginSession();
+		return valid;
+	}
+
+	inline bool isFinal() const {
+		return final_;
+	}
+	inline size_t numFrames() const {
+		return numFrames_;
+	}
+
+private:
+	static int classIndex(const char c) {
+		return (c >= '0' && c <= '9') ? (c - '0') : ((c >= 'A' && c <= 'Z') ? (c - 'A' + 10) : (c == '<' ? 36 : -1));
+	}
+	static char classChar(const int index) {
+		return index < 10 ? static_cast<char>('0' + index) : (index < 36 ? static_cast<char>('A' + index - 10) : '<');
+	}
+
+	// Builds the lines with the best voted characters, returns the lowest margin
+	float fuse(std::vector<std::string>& lines) const {
+		float minMargin = numFrames_ ? 1.f : 0.f;
+		lines.resize(numLines_);
+		for (size_t i = 0; i < numLines_; ++i) {
+			lines[i].assign(lineLength_, '<');
+			for (size_t j = 0; j < lineLength_; ++j) {
+				const float* votes = votes_[i][j];
+				int best = 0;
+				float first = 0.f, second = 0.f, sum = 0.f;
+				for (int k = 0; k < MRZ_SESSION_NUM_CLASSES; ++k) {
+					sum += votes[k];
+					if (votes[k] > first) {
+						second = first, first = votes[k], best = k;
+					}
+					else if (votes[k] > second) {
+						second = votes[k];
+					}
+				}
+				lines[i][j] = classChar(best);
+				minMargin = std::min(minMargin, sum > 0.f ? ((first - second) / sum) : 0.f);
+			}
+		}
+		return minMargin;
+	}
+
+private:
+	const size_t minFrames_;
+	const float minMargin_;
+	size_t numLines_;
+	size_t lineLength_;
+	size_t numFrames_;
+	bool final_;
+	float votes_[MRZ_SESSION_MAX_LINES][MRZ_RESULT_MAX_LINE_LENGTH][MRZ_SESSION_NUM_CLASSES];
+};
+
+#endif /* _ULTIMATE_MRZ_SDK_SAMPLES_SESSION_H_ */
@@ -0,0 +1,205 @@
+/* Copyright (C) 2016-2019 Doubango Telecom <https://www.doubango.org>
+* File author: Mamadou DIOP (Doubango Telecom, France).
+* License: For non commercial use only.
+* Source code: https://github.com/DoubangoTelecom/ultimateMRZ-SDK
+* WebSite: https://www.doubango.org/webapps/mrz/
+*/
+
+#if !defined(_ULTIMATE_MRZ_SDK_SAMPLES_STATS_H_)
+#define _ULTIMATE_MRZ_SDK_SAMPLES_STATS_H_
+
+#include "mrz_utils.h"
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+#define MRZ_STATS_HISTOGRAM_SUB_BUCKETS		8 // per power of two, ~12% precision
+#define MRZ_STATS_HISTOGRAM_NUM_BUCKETS		(MRZ_STATS_HISTOGRAM_SUB_BUCKETS * 29) // up to 2^30 microseconds
+
+/*
+* Lock-free latency histogram (microseconds) with log-linear buckets.
+*/
+class MrzHistogram {
+public:
+	MrzHistogram() {
+		reset();
+	}
+
+	inline void record(const uint64_t valueInMicros) {
+		buckets_[bucketIndex(valueInMicros)].fetch_add(1, std::memory_order_relaxed);
+		count_.fetch_add(1, std::memory_order_relaxed);
+		sum_.fetch_add(valueInMicros, std::memory_order_relaxed);
+	}
+	void reset() {
+		for (std::atomic<uint64_t>& bucket : buckets_) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		count_.store(0, std::memory_order_relaxed);
+		sum_.store(0, std::memory_order_relaxed);
+	}
+	inline uint64_t count() const {
+		return count_.load(std::memory_order_relaxed);
+	}
+	inline uint64_t sum() const {
+		return sum_.load(std::memory_order_relaxed);
+	}
+
+	/*
+	* Estimates a percentile from the buckets. Concurrent updates may be partially visible.
+	* @param percentile Within [0, 100].
+	* @returns the estimated value in microseconds (bucket midpoint)
+	*/
+	uint64_t percentile(const double percentile) const {
+		uint64_t counts[MRZ_STATS_HISTOGRAM_NUM_BUCKETS], total = 0;
+		for (size_t i = 0; i < MRZ_STATS_HISTOGRAM_NUM_BUCKETS; ++i) {
+			total += (counts[i] = buckets_[i].load(std::memory_order_relaxed));
+		}
+		if (!total) {
+			return 0;
+		}
+		const uint64_t rank = static_cast<uint64_t>((percentile / 100.0) * static_cast<double>(total - 1)) + 1;
+		uint64_t cumulated = 0;
+		for (size_t i = 0; i < MRZ_STATS_HISTOGRAM_NUM_BUCKETS; ++i) {
+			if ((cumulated += counts[i]) >= rank) {
+				return bucketMidpoint(i);
+			}
+		}
+		return bucketMidpoint(MRZ_STATS_HISTOGRAM_NUM_BUCKETS - 1);
+	}
+
+private:
+	static size_t bucketIndex(const uint64_t value) {
+		if (value < MRZ_STATS_HISTOGRAM_SUB_BUCKETS) {
+			return static_cast<size_t>(value);
+		}
+		size_t msb = 0;
+		for (uint64_t v = value; v >>= 1; ) ++msb;
+		const size_t index = ((msb - 2) * MRZ_STATS_HISTOGRAM_SUB_BUCKETS) + static_cast<size_t>((value >> (msb - 3)) & (MRZ_STATS_HISTOGRAM_SUB_BUCKETS - 1));
+		return std::min(index, static_cast<size_t>(MRZ_STATS_HISTOGRAM_NUM_BUCKETS - 1));
+	}
+	static uint64_t bucketMidpoint(const size_t index) {
+		if (index < MRZ_STATS_HISTOGRAM_SUB_BUCKETS) {
+			return static_cast<uint64_t>(index);
+		}
+		const size_t msb = (index / MRZ_STATS_HISTOGRAM_SUB_BUCKETS) + 2;
+		const uint64_t width = uint64_t(1) << (msb - 3);
+		return ((MRZ_STATS_HISTOGRAM_SUB_BUCKETS + (index % MRZ_STATS_HISTOGRAM_SUB_BUCKETS)) * width) + (width >> 1);
+	}
+
+private:
+	std::atomic<uint64_t> buckets_[MRZ_STATS_HISTOGRAM_NUM_BUCKETS];
+	std::atomic<uint64_t> count_;
+	std::atomic<uint64_t> sum_;
+};
+
+/*
+* Snapshot of the statistics. Plain old data, cheap to copy and export.
+*/
+struct MrzStatsSnapshot {
+	uint64_t framesProcessed;
+	uint64_t framesFailed;
+	uint64_t framesNegative; // no zone found
+	uint64_t zonesFound;
+	uint64_t latencyP50InMicros;
+	uint64_t latencyP95InMicros;
+	uint64_t latencyP99InMicros;
+	uint64_t latencyMeanInMicros;
+	uint64_t busyTotalInMicros; // sum of all latencies, divide by (uptime * number of callers) for the utilization
+	uint64_t waitP50InMicros; // time spent in the queue before a worker picks the frame
+	uint64_t waitP99InMicros;
+	uint64_t waitTotalInMicros;
+	uint64_t uptimeInMicros; // time since the creation or last reset
+	size_t memoryCurrentInBytes; // zero if not available on this platform
+	size_t memoryPeakInBytes;
+};
+
+/*
+* Engine-wide statistics. Updating is lock-free (relaxed atomics) which means it could be shared by all
+* threads calling the engine. Taking a snapshot doesn't block the updaters.
+*/
+class MrzStats {
+public:
+	MrzStats() {
+		reset();
+	}
+
+	/*
+	* Records a processed frame.
+	* @param result
+	* @param latencyInMicros Time spent in UltMrzSdkEngine::process().
+	*/
+	inline void recordFrame(const UltMrzSdkResult& result, const uint64_t latencyInMicros) {
+		framesProcessed_.fetch_add(1, std::memory_order_relaxed);
+		if (!result.isOK()) {
+			framesFailed_.fetch_add(1, std::memory_order_relaxed);
+		}
+		else if (!result.numZones()) {
+			framesNegative_.fetch_add(1, std::memory_order_relaxed);
+		}
+		zonesFound_.fetch_add(result.numZones(), std::memory_order_relaxed);
+		latency_.record(latencyInMicros);
+	}
+	inline void recordWait(const uint64_t waitInMicros) {
+		wait_.record(waitInMicros);
+	}
+
+	MrzStatsSnapshot snapshot() const {
+		MrzStatsSnapshot snapshot;
+		snapshot.framesProcessed = framesProcessed_.load(std::memory_order_relaxed);
+		snapshot.framesFailed = framesFailed_.load(std::memory_order_relaxed);
+		snapshot.framesNegative = framesNegative_.load(std::memory_order_relaxed);
+		snapshot.zonesFound = zonesFound_.load(std::memory_order_relaxed);
+		snapshot.latencyP50InMicros = latency_.percentile(50.0);
+		snapshot.latencyP95InMicros = latency_.percentile(95.0);
+		snapshot.latencyP99InMicros = latency_.percentile(99.0);
+		const uint64_t count = latency_.count();
+		snapshot.busyTotalInMicros = latency_.sum();
+		snapshot.latencyMeanInMicros = count ? (snapshot.busyTotalInMicros / count) : 0;
+		snapshot.waitP50InMicros = wait_.percentile(50.0);
+		snapshot.waitP99InMicros = wait_.percentile(99.0);
+		snapshot.waitTotalInMicros = wait_.sum();
+		snapshot.uptimeInMicros = static_cast<uint64_t>(nowInMicros() - startTime_.load(std::memory_order_relaxed));
+		mrzMemoryUsage(snapshot.memoryCurrentInBytes, snapshot.memoryPeakInBytes);
+		return snapshot;
+	}
+
+	void reset() {
+		framesProcessed_.store(0, std::memory_order_relaxed);
+		framesFailed_.store(0, std::memory_order_relaxed);
+		framesNegative_.store(0, std::memory_order_relaxed);
+		zonesFound_.store(0, std::memory_order_relaxed);
+		latency_.reset();
+		wait_.reset();
+		startTime_.store(nowInMicros(), std::memory_order_relaxed);
+	}
+
+	// Steady clock used by all the helpers (stats, tracer, async processor, frame scheduler): timestamps could be mixed
+	static inline int64_t nowInMicros() {
+		return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+private:
+	std::atomic<uint64_t> framesProcessed_;
+	std::atomic<uint64_t> framesFailed_;
+	std::atomic<uint64_t> framesNegative_;
+	std::atomic<uint64_t> zonesFound_;
+	MrzHistogram latency_;
+	MrzHistogram wait_;
+	std::atomic<int64_t> startTime_;
+};
+
+/*
+* Processes an image and records the result and latency in the statistics.
+* @param image
+* @param stats
+* @returns the engine result
+*/
+static inline UltMrzSdkResult mrzProcessImageWithStats(const MrzImage& image, MrzStats& stats)
+{
+	const int64_t timeStart = MrzStats::nowInMicros();
+	UltMrzSdkResult result = mrzProcessImage(image);
+	stats.recordFrame(result, static_cast<uint64_t>(MrzStats::nowInMicros() - timeStart));
+	return result;
+}
+
+#endif /* _ULTIMATE_MRZ_SDK_SAMPLES_STATS_H_ */
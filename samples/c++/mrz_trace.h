@@ -0,0 +1,145 @@
+/* Copyright (C) 2016-2019 Doubango Telecom <https://www.doubango.org>
+* File author: Mamadou DIOP (Doubango Telecom, France).
+* License: For non commercial use only.
+* Source code: https://github.com/DoubangoTelecom/ultimateMRZ-SDK
+* WebSite: https://www.doubango.org/webapps/mrz/
+*/
+
+#if !defined(_ULTIMATE_MRZ_SDK_SAMPLES_TRACE_H_)
+#define _ULTIMATE_MRZ_SDK_SAMPLES_TRACE_H_
+
+#include "mrz_utils.h"
+#include "mrz_stats.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/*
+* Trace recorder: keeps the last "capacity" events in a ring buffer and writes them as a Chrome trace
+* JSON file ("Trace Event Format"), which could be opened with chrome://tracing or https://ui.perfetto.dev.
+* Each event is a complete event ("ph":"X") with a begin timestamp, a duration and the recording thread.
+* Recording is disabled by default and costs a single atomic load when disabled.
+*
+* Usage:
+* \code{.cpp}
+* mrzTracer().enable(4096);
+* { MrzTraceScope scope("process"); ... }
+* mrzTracer().dump("trace.json");
+* \endcode
+*/
+class MrzTracer {
+public:
+	struct Event {
+		const char* name; // must be a literal (not copied)
+		int64_t begin; // microseconds, MrzStats::nowInMicros()
+		int64_t duration; // microseconds
+		uint32_t threadId;
+		int64_t frameId; // -1 if not defined
+	};
+
+	/*
+	* Starts recording. The previous events are discarded.
+	* @param capacity Maximum number of events kept, the oldest ones are overwritten.
+	*/
+	void enable(const size_t capacity = 4096) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		events_.assign(capacity ? capacity : 1, Event());
+		next_ = 0, count_ = 0;
+		enabled_.store(true, std::memory_order_release);
+	}
+	void disable() {
+		enabled_.store(false, std::memory_order_release);
+	}
+	inline bool isEnabled() const {
+		return enabled_.load(std::memory_order_relaxed);
+	}
+
+	void record(const char* name, const int64_t begin, const int64_t end, const int64_t frameId = -1) {
+		const uint32_t threadId = currentThreadId();
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (events_.empty()) {
+			return;
+		}
+		Event& event = events_[next_];
+		event.name = name, event.begin = begin, event.duration = end - begin, event.threadId = threadId, event.frameId = frameId;
+		next_ = (next_ + 1) % events_.size();
+		count_ = std::min(count_ + 1, events_.size());
+	}
+
+	/*
+	* Writes the recorded events as a Chrome trace JSON file. Could be called while recording.
+	* @param path
+	* @returns true if the file was written, false otherwise
+	*/
+	bool dump(const std::string& path) const {
+		FILE* file = fopen(path.c_str(), "wb");
+		if (!file) {
+			ULTMRZ_SDK_PRINT_ERROR("Can't create %s", path.c_str());
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(mutex_);
+		fputs("{\"traceEvents\":[", file);
+		const size_t first = (next_ + events_.size() - count_) % std::max(events_.size(), size_t(1));
+		for (size_t i = 0; i < count_; ++i) {
+			const Event& event = events_[(first + i) % events_.size()];
+			fprintf(file, "%s\n{\"name\":\"%s\",\"cat\":\"mrz\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%u",
+				i ? "," : "", event.name, static_cast<long long>(event.begin), static_cast<long long>(event.duration), event.threadId);
+			if (event.frameId >= 0) {
+				fprintf(file, ",\"args\":{\"frame_id\":%lld}", static_cast<long long>(event.frameId));
+			}
+			fputc('}', file);
+		}
+		fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+		return fclose(file) == 0;
+	}
+
+private:
+	// Small sequential ids are easier to read in the trace viewers than the native ones
+	static uint32_t currentThreadId() {
+		static std::atomic<uint32_t> counter(0);
+		static thread_local const uint32_t threadId = ++counter;
+		return threadId;
+	}
+
+private:
+	std::atomic<bool> enabled_{ false };
+	mutable std::mutex mutex_;
+	std::vector<Event> events_;
+	size_t next_ = 0;
+	size_t count_ = 0;
+};
+
+/*
+* Process-wide tracer
+*/
+inline MrzTracer& mrzTracer() // not static: a single instance shared by all translation units
+{
+	static MrzTracer tracer;
+	return tracer;
+}
+
+/*
+* Records an event covering the lifetime of the object, only if the tracer is enabled.
+*/
+class MrzTraceScope {
+public:
+	MrzTraceScope(const char* name, const int64_t frameId = -1)
+		: name_(name), frameId_(frameId), begin_(mrzTracer().isEnabled() ? MrzStats::nowInMicros() : -1) { }
+	~MrzTraceScope() {
+		if (begin_ >= 0) {
+			mrzTracer().record(name_, begin_, MrzStats::nowInMicros(), frameId_);
+		}
+	}
+	inline void setFrameId(const int64_t frameId) {
+		frameId_ = frameId;
+	}
+
+private:
+	const char* name_;
+	int64_t frameId_;
+	const int64_t begin_;
+};
+
+#endif /* _ULTIMATE_MRZ_SDK_SAMPLES_TRACE_H_ */
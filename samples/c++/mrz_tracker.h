@@ -0,0 +1,101 @@
+/* Copyright (C) 2016-2019 Doubango Telecom <https://www.doubango.org>
+* File author: Mamadou DIOP (Doubango Telecom, France).
+* License: For non commercial use only.
+* Source code: https://github.com/DoubangoTelecom/ultimateMRZ-SDK
+* WebSite: https://www.doubango.org/webapps/mrz/
+*/
+
+#if !defined(_ULTIMATE_MRZ_SDK_SAMPLES_TRACKER_H_)
+#define _ULTIMATE_MRZ_SDK_SAMPLES_TRACKER_H_
+
+#include "mrz_roi.h"
+
+/*
+* Video tracking: when the MRZ zones were found in the previous frame, only a padded window around
+* them is processed. The full frame is processed again when the window doesn't contain a zone anymore
+* or when the lowest line confidence drops below "minConfidence".
+* The zones/lines in "mrzResult" are always in full frame coordinates. The JSON string in the engine result
+* is left untouched which means it's relative to the window when tracking.
+* Only frames with EXIF orientation equal to 1 are tracked, the other ones always use full frame detection.
+*/
+class MrzTracker {
+public:
+	MrzTracker(const float padding = 0.1f, const float minConfidence = 0.f)
+		: padding_(padding), minConfidence_(minConfidence) { }
+
+	/*
+	* Processes a frame.
+	* @param image The frame.
+	* @param result The engine result (reused across frames).
+	* @param mrzResult The decoded result, in full frame coordinates.
+	* @returns the engine result
+	*/
+	const UltMrzSdkResult& process(const MrzImage& image, UltMrzSdkResult& result, MrzResult& mrzResult) {
+		if (tracking_ && image.exifOrientation == 1) {
+			if (mrzProcessWindow(image, box_, result, mrzResult) && isConfident(mrzResult)) {
+				track(mrzResult, image);
+				++trackedFrames_;
+				return result;
+			}
+			++lostFrames_;
+		}
+		// Full frame detection
+		result = mrzProcessImage(image);
+		tracking_ = false;
+		if (result.isOK() && result.numZones() && mrzResultDecode(result, mrzResult)) {
+			if (image.exifOrientation == 1 && isConfident(mrzResult)) {
+				track(mrzResult, image);
+			}
+		}
+		else {
+			mrzResult.clear();
+		}
+		return result;
+	}
+
+	void reset() {
+		tracking_ = false;
+	}
+	inline bool isTracking() const {
+		return tracking_;
+	}
+	inline size_t trackedFrames() const {
+		return trackedFrames_;
+	}
+	inline size_t lostFrames() const {
+		return lostFrames_;
+	}
+
+private:
+	bool isConfident(const MrzResult& mrzResult) const {
+		for (const MrzLine& line : mrzResult.lines) {
+			if (line.confidence < minConfidence_) {
+				return false;
+			}
+		}
+		return !mrzResult.zones.empty();
+	}
+
+	// Computes the padded window (left, top, right, bottom) around all zones
+	void track(const MrzResult& mrzResult, const MrzImage& image) {
+		float left = FLT_MAX, top = FLT_MAX, right = -FLT_MAX, bottom = -FLT_MAX;
+		for (const MrzZone& zone : mrzResult.zones) {
+			float bounds[4];
+			mrzQuadBounds(zone.warpedBox, padding_, image, bounds);
+			left = std::min(left, bounds[0]), top = std::min(top, bounds[1]);
+			right = std::max(right, bounds[2]), bottom = std::max(bottom, bounds[3]);
+		}
+		box_[0] = left, box_[1] = top, box_[2] = right, box_[3] = bottom;
+		tracking_ = (box_[2] > box_[0] && box_[3] > box_[1]);
+	}
+
+private:
+	const float padding_;
+	const float minConfidence_;
+	bool tracking_ = false;
+	float box_[4] = { 0.f, 0.f, 0.f, 0.f };
+	size_t trackedFrames_ = 0;
+	size_t lostFrames_ = 0;
+};
+
+#endif /* _ULTIMATE_MRZ_SDK_SAMPLES_TRACKER_H_ */
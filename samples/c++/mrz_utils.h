@@ -9,9 +9,14 @@
 #define _ULTIMATE_MRZ_SDK_SAMPLES_UTILS_H_
 
 #include <ultimateMRZ-SDK-API-PUBLIC.h>
+#include "mrz_probes.h"
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <map>
+#include <vector>
+#include <algorithm>
 #include <sys/stat.h>
 
 // Not part of the SDK, used to decode images -> https://github.com/nothings/stb
@@ -98,6 +103,288 @@ static bool mrzDecodeFile(const std::string& path, MrzFile& mrzFile)
 	return true;
 }
 
+/*
+* Image description used to pass frames around without caring about the image layout.
+* For packed formats (RGB-family, Y) only "data" is required. For YUV-family formats
+* set "uPtr" and "vPtr" too and use the strides in bytes.
+*/
+struct MrzImage {
+	ULTMRZ_SDK_IMAGE_TYPE type = ULTMRZ_SDK_IMAGE_TYPE_RGB24;
+	const void* data = nullptr; // Packed data or Y (luma) samples
+	const void* uPtr = nullptr;
+	const void* vPtr = nullptr;
+	size_t width = 0;
+	size_t height = 0;
+	size_t strideInSamples = 0; // Packed formats only, zero if not strided
+	size_t yStrideInBytes = 0;
+	size_t uStrideInBytes = 0;
+	size_t vStrideInBytes = 0;
+	size_t uvPixelStrideInBytes = 0;
+	int exifOrientation = 1;
+
+	inline bool isPlanar() const {
+		return (uPtr != nullptr && vPtr != nullptr);
+	}
+	inline bool isValid() const {
+		return (data != nullptr && width && height);
+	}
+};
+
+/*
+* Builds an image description from a decoded file
+* @param mrzFile
+* @returns
+*/
+static inline MrzImage mrzFileToImage(const MrzFile& mrzFile)
+{
+	MrzImage image;
+	image.type = mrzFile.type;
+	image.data = mrzFile.uncompressedData;
+	image.width = mrzFile.width;
+	image.height = mrzFile.height;
+	return image;
+}
+
+/*
+* Creates a window on an image without copying the pixels: only the pointers and strides are updated.
+* For YUV-family formats the window origin is rounded down to match the chroma subsampling.
+* @param image
+* @param x Left position of the window, in samples.
+* @param y Top position of the window, in samples.
+* @param width Width of the window, in samples. Clipped to the image.
+* @param height Height of the window, in samples. Clipped to the image.
+* @param crop The window. (x, y) is updated with the actual origin.
+* @returns false if the window is empty or the image type not supported, true otherwise
+*/
+static inline bool mrzImageCrop(const MrzImage& image, size_t& x, size_t& y, size_t width, size_t height, MrzImage& crop)
+{
+	ULTMRZ_SDK_ASSERT(image.isValid());
+	size_t subX = 1, subY = 1, bytesPerSample = 1;
+	switch (image.type) {
+	case ULTMRZ_SDK_IMAGE_TYPE_RGB24: case ULTMRZ_SDK_IMAGE_TYPE_BGR24: bytesPerSample = 3; break;
+	case ULTMRZ_SDK_IMAGE_TYPE_RGBA32: case ULTMRZ_SDK_IMAGE_TYPE_BGRA32: bytesPerSample = 4; break;
+	case ULTMRZ_SDK_IMAGE_TYPE_Y: case ULTMRZ_SDK_IMAGE_TYPE_YUV444P: break;
+	case ULTMRZ_SDK_IMAGE_TYPE_YUV422P: subX = 2; break;
+	case ULTMRZ_SDK_IMAGE_TYPE_NV12: case ULTMRZ_SDK_IMAGE_TYPE_NV21:
+	case ULTMRZ_SDK_IMAGE_TYPE_YUV420P: case ULTMRZ_SDK_IMAGE_TYPE_YVU420P: subX = subY = 2; break;
+	default: return false;
+	}
+	x -= (x % subX);
+	y -= (y % subY);
+	if (x >= image.width || y >= image.height) {
+		return false;
+	}
+	width = std::min(width, image.width - x);
+	height = std::min(height, image.height - y);
+	if (!width || !height) {
+		return false;
+	}
+	crop = image;
+	crop.width = width;
+	crop.height = height;
+	if (image.isPlanar()) {
+		const bool semiPlanar = (image.type == ULTMRZ_SDK_IMAGE_TYPE_NV12 || image.type == ULTMRZ_SDK_IMAGE_TYPE_NV21);
+		const size_t yStride = image.yStrideInBytes ? image.yStrideInBytes : image.width;
+		const size_t uvPixelStride = image.uvPixelStrideInBytes ? image.uvPixelStrideInBytes : (semiPlanar ? 2 : 1);
+		const size_t uStride = image.uStrideInBytes ? image.uStrideInBytes : (((image.width + subX - 1) / subX) * uvPixelStride);
+		const size_t vStride = image.vStrideInBytes ? image.vStrideInBytes : uStride;
+		crop.data = reinterpret_cast<const uint8_t*>(image.data) + (y * yStride) + x;
+		crop.uPtr = reinterpret_cast<const uint8_t*>(image.uPtr) + ((y / subY) * uStride) + ((x / subX) * uvPixelStride);
+		crop.vPtr = reinterpret_cast<const uint8_t*>(image.vPtr) + ((y / subY) * vStride) + ((x / subX) * uvPixelStride);
+		crop.yStrideInBytes = yStride;
+		crop.uStrideInBytes = uStride;
+		crop.vStrideInBytes = vStride;
+		crop.uvPixelStrideInBytes = uvPixelStride;
+	}
+	else {
+		const size_t stride = image.strideInSamples ? image.strideInSamples : image.width;
+		crop.data = reinterpret_cast<const uint8_t*>(image.data) + (((y * stride) + x) * bytesPerSample);
+		crop.strideInSamples = stride;
+	}
+	return true;
+}
+
+/*
+* Processes an image using the overload matching its layout
+* @param image
+* @returns
+*/
+static inline UltMrzSdkResult mrzProcessImage(const MrzImage& image)
+{
+	ULTMRZ_SDK_ASSERT(image.isValid());
+	MRZ_PROBE3(process__entry, image.width, image.height, static_cast<int>(image.type));
+	UltMrzSdkResult result = image.isPlanar()
+		? UltMrzSdkEngine::process(
+			image.type,
+			image.data, image.uPtr, image.vPtr,
+			image.width, image.height,
+			image.yStrideInBytes, image.uStrideInBytes, image.vStrideInBytes,
+			image.uvPixelStrideInBytes,
+			image.exifOrientation
+		)
+		: UltMrzSdkEngine::process(
+			image.type,
+			image.data,
+			image.width, image.height,
+			image.strideInSamples,
+			image.exifOrientation
+		);
+	MRZ_PROBE2(process__return, result.code(), result.numZones());
+	return result;
+}
+
+/*
+* Processes a batch of images. The results vector is only resized when the batch grows which means
+* it could be reused across calls to avoid allocating the result objects for each batch.
+* The engine has no batch entry point: this is a loop over UltMrzSdkEngine::process(), not faster than calling it yourself.
+* @param images
+* @param count
+* @param results One result per image, in the same order as the images.
+* @returns true if all images were successfully processed, false otherwise
+*/
+static inline bool mrzProcessBatch(const MrzImage* images, const size_t count, std::vector<UltMrzSdkResult>& results)
+{
+	ULTMRZ_SDK_ASSERT(images != nullptr || !count);
+	if (results.size() < count) {
+		results.resize(count);
+	}
+	bool allOK = true;
+	for (size_t i = 0; i < count; ++i) {
+		results[i] = mrzProcessImage(images[i]);
+		allOK &= results[i].isOK();
+	}
+	return allOK;
+}
+
+/*
+* Processes blank frames so that all lazy initializations (deep learning models loading, threads, buffers...)
+* are done before the first real frame. Call it right after UltMrzSdkEngine::init.
+* No MRZ zone is detected on a blank frame which means the recognizer (OCR) may not run and stays cold: use
+* the next function with a sample frame containing an MRZ to warm up all stages.
+* @param maxWidth Maximum width of the frames you'll process, in samples.
+* @param maxHeight Maximum height of the frames you'll process, in samples.
+* @param types The image types you'll process.
+* @param numTypes
+* @returns true if all blank frames were processed, false otherwise
+*/
+static inline bool mrzWarmUp(const size_t maxWidth, const size_t maxHeight, const ULTMRZ_SDK_IMAGE_TYPE* types, const size_t numTypes)
+{
+	ULTMRZ_SDK_ASSERT(maxWidth && maxHeight && types && numTypes);
+	const size_t width = (maxWidth + 1) & ~size_t(1), height = (maxHeight + 1) & ~size_t(1);
+	std::vector<uint8_t> buffer(width * height * 4, 0); // large enough for RGBA32 and YUV444P
+	uint8_t* y = buffer.data();
+	uint8_t* u = y + (width * height);
+	uint8_t* v = u + (width * height);
+	bool allOK = true;
+	for (size_t i = 0; i < numTypes; ++i) {
+		MrzImage image;
+		image.type = types[i];
+		image.data = y;
+		image.width = width;
+		image.height = height;
+		switch (types[i]) {
+		case ULTMRZ_SDK_IMAGE_TYPE_NV12: case ULTMRZ_SDK_IMAGE_TYPE_NV21:
+			image.uPtr = u, image.vPtr = u + 1;
+			image.yStrideInBytes = width, image.uStrideInBytes = image.vStrideInBytes = width, image.uvPixelStrideInBytes = 2;
+			break;
+		case ULTMRZ_SDK_IMAGE_TYPE_YUV420P: case ULTMRZ_SDK_IMAGE_TYPE_YVU420P: case ULTMRZ_SDK_IMAGE_TYPE_YUV422P:
+			image.uPtr = u, image.vPtr = v;
+			image.yStrideInBytes = width, image.uStrideInBytes = image.vStrideInBytes = (width >> 1), image.uvPixelStrideInBytes = 1;
+			break;
+		case ULTMRZ_SDK_IMAGE_TYPE_YUV444P:
+			image.uPtr = u, image.vPtr = v;
+			image.yStrideInBytes = image.uStrideInBytes = image.vStrideInBytes = width, image.uvPixelStrideInBytes = 1;
+			break;
+		default:
+			break;
+		}
+		const UltMrzSdkResult result = mrzProcessImage(image);
+		if (!result.isOK()) {
+			ULTMRZ_SDK_PRINT_ERROR("Warm-up failed for type %d: %s", static_cast<int>(types[i]), result.phrase());
+			allOK = false;
+		}
+	}
+	return allOK;
+}
+
+/*
+* Same as above using sample frames instead of blank ones. Use at least one frame with an MRZ (e.g. a
+* passport image) so that both the detector and the recognizer are warmed up.
+* @param images The sample frames, same sizes and types as the ones you'll process.
+* @param numImages
+* @returns true if all sample frames were processed, false otherwise
+*/
+static inline bool mrzWarmUp(const MrzImage* images, const size_t numImages)
+{
+	ULTMRZ_SDK_ASSERT(images && numImages);
+	bool allOK = true;
+	for (size_t i = 0; i < numImages; ++i) {
+		const UltMrzSdkResult result = mrzProcessImage(images[i]);
+		if (!result.isOK()) {
+			ULTMRZ_SDK_PRINT_ERROR("Warm-up failed for sample %zu: %s", i, result.phrase());
+			allOK = false;
+		}
+	}
+	return allOK;
+}
+
+/*
+* Retrieves the memory used by the process (application and SDK).
+* Only available on Linux and Android (/proc/self/status).
+* @param current Resident set size in bytes (VmRSS).
+* @param peak Peak resident set size in bytes (VmHWM).
+* @returns false if not available on this platform, true otherwise
+*/
+static inline bool mrzMemoryUsage(size_t& current, size_t& peak)
+{
+	current = peak = 0;
+#if defined(__linux__) || ULTMRZ_SDK_OS_ANDROID
+	FILE* file = fopen("/proc/self/status", "r");
+	if (!file) {
+		return false;
+	}
+	char line[256];
+	unsigned long long valueInKB;
+	while (fgets(line, sizeof(line), file)) {
+		if (sscanf(line, "VmRSS: %llu kB", &valueInKB) == 1) {
+			current = static_cast<size_t>(valueInKB) << 10;
+		}
+		else if (sscanf(line, "VmHWM: %llu kB", &valueInKB) == 1) {
+			peak = static_cast<size_t>(valueInKB) << 10;
+		}
+	}
+	fclose(file);
+	return (current && peak);
+#else
+	return false;
+#endif
+}
+
+#define MRZ_RESULT_CODE_MEMORY_BUDGET_EXCEEDED	0x7FFF0001
+
+/*
+* Processes an image only if the memory used by the process stays within a budget. Returns a clean
+* error result (code = MRZ_RESULT_CODE_MEMORY_BUDGET_EXCEEDED) instead of letting the system kill the process.
+* The check is done before processing using the current resident set size plus a lower bound estimation
+* of the memory needed for the frame (one RGBA copy of the image). The SDK doesn't expose its internal
+* memory usage which means the budget should keep some headroom.
+* @param image
+* @param budgetInBytes Maximum memory for the process, zero means no budget.
+* @returns the engine result or an error result if the budget would be exceeded
+*/
+static inline UltMrzSdkResult mrzProcessImageWithinBudget(const MrzImage& image, const size_t budgetInBytes)
+{
+	size_t current, peak;
+	if (budgetInBytes && mrzMemoryUsage(current, peak)) {
+		const size_t estimated = current + (image.width * image.height * 4);
+		if (estimated > budgetInBytes) {
+			ULTMRZ_SDK_PRINT_WARN("Memory budget exceeded: %zu > %zu", estimated, budgetInBytes);
+			return UltMrzSdkResult::bodyless(MRZ_RESULT_CODE_MEMORY_BUDGET_EXCEEDED, "Memory budget exceeded");
+		}
+	}
+	return mrzProcessImage(image);
+}
+
 static bool mrzParseArgs(int argc, char *argv[], std::map<std::string, std::string >& values)
 {
 	ULTMRZ_SDK_ASSERT(argc > 0 && argv != nullptr);
@@ -32,12 +32,15 @@
 #include <sys/stat.h>
 #include <map>
 #include <algorithm>
+#include <chrono>
 
 // Not part of the SDK, used to decode images -> https://github.com/nothings/stb
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_STATIC
 #include "../stb_image.h"
 
+#include "../mrz_cpu.h"
+
 using namespace ultimateMrzSdk;
 
 struct MrzFile {
@@ -155,6 +158,8 @@ int main(int argc, char *argv[])
 		jsonConfig += std::string(",\"license_token_data\": \"") + licenseTokenData + std::string("\"");
 	}
 
+	mrzConfigAutoNumThreads(jsonConfig); // honor the container CPU quota and cpuset
+	
 	jsonConfig += "}"; // end-of-config
 
 	// Decode the file
@@ -167,9 +172,11 @@ int main(int argc, char *argv[])
 
 	// Init
 	ULTMRZ_SDK_PRINT_INFO("Initialization...");
+	const std::chrono::high_resolution_clock::time_point timeStartInit = std::chrono::high_resolution_clock::now();
 	ULTMRZ_SDK_ASSERT((result = UltMrzSdkEngine::init(
 		jsonConfig.c_str()
 	)).isOK());
+	const std::chrono::high_resolution_clock::time_point timeEndInit = std::chrono::high_resolution_clock::now();
 
 	// Recognize/Process
 	// Please note that the first time you call this function all deep learning models will be loaded 
@@ -183,6 +190,13 @@ int main(int argc, char *argv[])
 		0, // stride
 		UltMrzSdkEngine::exifOrientation(file.compressedDataPtr, file.compressedDataSize)
 	)).isOK());
+	const std::chrono::high_resolution_clock::time_point timeEndProcess = std::chrono::high_resolution_clock::now();
+
+	// Print time-to-ready: init() then first process() call (models loading and initialization)
+	const double initTimeInMillis = std::chrono::duration_cast<std::chrono::duration<double >>(timeEndInit - timeStartInit).count() * 1000.0;
+	const double firstProcessTimeInMillis = std::chrono::duration_cast<std::chrono::duration<double >>(timeEndProcess - timeEndInit).count() * 1000.0;
+	ULTMRZ_SDK_PRINT_INFO("*** init: %lf millis, first process: %lf millis, time-to-ready: %lf millis ***", 
+		initTimeInMillis, firstProcessTimeInMillis, initTimeInMillis + firstProcessTimeInMillis);
 
 	// Print result
 	// The JSON content contains the MRZ lines with the coordinates and texts.